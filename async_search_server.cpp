@@ -0,0 +1,105 @@
+#include "async_search_server.h"
+
+#include <algorithm>
+#include <exception>
+#include <execution>
+
+using namespace std;
+
+AsyncSearchServer::AsyncSearchServer(const SearchServer& search_server, size_t thread_count, size_t max_queue_depth)
+	: search_server_(search_server)
+	, max_queue_depth_(max(max_queue_depth, size_t{ 1 }))
+{
+	if (thread_count == 0) {
+		thread_count = max(thread::hardware_concurrency(), 1u);
+	}
+	workers_.reserve(thread_count);
+	for (size_t i = 0; i < thread_count; ++i) {
+		workers_.emplace_back([this] { RunWorker(); });
+	}
+}
+
+AsyncSearchServer::~AsyncSearchServer()
+{
+	{
+		lock_guard guard(mutex_);
+		stop_ = true;
+	}
+	queue_cv_.notify_all();
+	for (thread& worker : workers_) {
+		worker.join();
+	}
+}
+
+std::future<std::vector<Document>> AsyncSearchServer::SubmitQuery(std::string raw_query, DocumentStatus status,
+	Clock::duration timeout)
+{
+	// без таймаута дедлайн - максимальное время, сложение переполнилось бы
+	const Clock::time_point now = Clock::now();
+	const Clock::time_point deadline = timeout < Clock::time_point::max() - now ? now + timeout : Clock::time_point::max();
+	Request request{ move(raw_query), status, deadline, {} };
+	auto result = request.result.get_future();
+	{
+		lock_guard guard(mutex_);
+		if (queue_.size() >= max_queue_depth_) {
+			++stats_.rejected;
+			throw QueryRejected();
+		}
+		++stats_.accepted;
+		queue_.push_back(move(request));
+	}
+	queue_cv_.notify_one();
+	return result;
+}
+
+size_t AsyncSearchServer::GetQueueDepth() const
+{
+	lock_guard guard(mutex_);
+	return queue_.size();
+}
+
+bool AsyncSearchServer::IsOverloaded() const
+{
+	return GetQueueDepth() * 4 > max_queue_depth_ * 3;
+}
+
+AsyncSearchServer::Stats AsyncSearchServer::GetStats() const
+{
+	lock_guard guard(mutex_);
+	return stats_;
+}
+
+void AsyncSearchServer::RunWorker()
+{
+	SearchServer::QueryScratch scratch;
+	while (true) {
+		Request request;
+		{
+			unique_lock lock(mutex_);
+			queue_cv_.wait(lock, [this] { return stop_ || !queue_.empty(); });
+			if (queue_.empty()) {
+				return;
+			}
+			request = move(queue_.front());
+			queue_.pop_front();
+		}
+		try {
+			// дедлайн мог пройти, пока запрос ждал в очереди
+			if (Clock::now() >= request.deadline) {
+				throw QueryDeadlineExceeded();
+			}
+			scratch.SetDeadline(request.deadline);
+			request.result.set_value(search_server_.FindTopDocuments(execution::seq, scratch, request.raw_query, request.status));
+		}
+		catch (const QueryDeadlineExceeded&) {
+			{
+				lock_guard guard(mutex_);
+				++stats_.expired;
+			}
+			request.result.set_exception(current_exception());
+		}
+		catch (...) {
+			request.result.set_exception(current_exception());
+		}
+	}
+}
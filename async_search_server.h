@@ -0,0 +1,78 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "search_server.h"
+
+// запрос не принят: очередь AsyncSearchServer заполнена
+class QueryRejected : public std::runtime_error {
+public:
+	QueryRejected()
+		: std::runtime_error("Query queue is full") {
+	}
+};
+
+// Асинхронные запросы к SearchServer: SubmitQuery ставит запрос в ограниченную очередь и сразу возвращает future,
+// запросы выполняет пул из thread_count потоков перегрузкой FindTopDocuments с QueryScratch.
+// Когда в очереди max_queue_depth запросов, новые отклоняются исключением QueryRejected (контроль допуска);
+// IsOverloaded() заранее сообщает, что очередь почти заполнена и поток запросов пора придержать.
+// У запроса может быть таймаут: не успевший запрос прерывается посреди перебора документов,
+// а future получает QueryDeadlineExceeded. Время ожидания в очереди входит в таймаут.
+// Сервер не должен меняться, пока есть принятые и не выполненные запросы.
+class AsyncSearchServer {
+public:
+	using Clock = std::chrono::steady_clock;
+
+	struct Stats {
+		uint64_t accepted = 0;
+		uint64_t rejected = 0;
+		uint64_t expired = 0;
+	};
+
+	// thread_count = 0 - по числу ядер
+	explicit AsyncSearchServer(const SearchServer& search_server, size_t thread_count = 0, size_t max_queue_depth = 1024);
+	// дожидается выполнения уже принятых запросов
+	~AsyncSearchServer();
+
+	AsyncSearchServer(const AsyncSearchServer&) = delete;
+	AsyncSearchServer& operator=(const AsyncSearchServer&) = delete;
+
+	std::future<std::vector<Document>> SubmitQuery(std::string raw_query, DocumentStatus status = DocumentStatus::ACTUAL,
+		Clock::duration timeout = Clock::duration::max());
+
+	// запросов ждёт в очереди
+	size_t GetQueueDepth() const;
+
+	// очередь заполнена больше чем на три четверти
+	bool IsOverloaded() const;
+
+	Stats GetStats() const;
+
+private:
+	struct Request {
+		std::string raw_query;
+		DocumentStatus status;
+		Clock::time_point deadline;
+		std::promise<std::vector<Document>> result;
+	};
+
+	const SearchServer& search_server_;
+	const size_t max_queue_depth_;
+	mutable std::mutex mutex_;
+	std::condition_variable queue_cv_;
+	std::deque<Request> queue_;
+	Stats stats_;
+	bool stop_ = false;
+	std::vector<std::thread> workers_;
+
+	void RunWorker();
+};
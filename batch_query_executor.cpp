@@ -0,0 +1,163 @@
+#include "batch_query_executor.h"
+
+#include <algorithm>
+#include <execution>
+
+using namespace std;
+
+BatchQueryExecutor::BatchQueryExecutor(size_t thread_count, bool split_tail_queries)
+	: split_tail_queries_(split_tail_queries)
+{
+	if (thread_count == 0) {
+		thread_count = max(thread::hardware_concurrency(), 1u);
+	}
+	workers_.reserve(thread_count);
+	for (size_t i = 0; i < thread_count; ++i) {
+		workers_.push_back(make_unique<Worker>());
+	}
+	for (size_t i = 0; i < thread_count; ++i) {
+		workers_[i]->thread = thread([this, i] { RunWorker(i); });
+	}
+}
+
+BatchQueryExecutor::~BatchQueryExecutor()
+{
+	{
+		lock_guard guard(state_mutex_);
+		stop_ = true;
+	}
+	start_cv_.notify_all();
+	for (auto& worker : workers_) {
+		worker->thread.join();
+	}
+}
+
+void BatchQueryExecutor::Process(const SearchServer& search_server, const std::vector<std::string>& queries,
+	const ResultCallback& on_result)
+{
+	Batch batch;
+	batch.search_server = &search_server;
+	batch.queries = &queries;
+	batch.on_result = &on_result;
+	Run(batch);
+}
+
+void BatchQueryExecutor::ProcessInto(const SearchServer& search_server, const std::vector<std::string>& queries,
+	Document* output, size_t slot_size, size_t* counts)
+{
+	Batch batch;
+	batch.search_server = &search_server;
+	batch.queries = &queries;
+	batch.output = output;
+	batch.slot_size = slot_size;
+	batch.counts = counts;
+	Run(batch);
+}
+
+void BatchQueryExecutor::Run(Batch& batch)
+{
+	const std::vector<std::string>& queries = *batch.queries;
+	if (queries.empty()) {
+		return;
+	}
+	batch.remaining_count = queries.size();
+
+	// соседние запросы - в одну очередь: поток сначала идёт по своему участку, чужие забираются с другого конца
+	const size_t part_size = (queries.size() + workers_.size() - 1) / workers_.size();
+	for (size_t i = 0; i < workers_.size(); ++i) {
+		lock_guard guard(workers_[i]->tasks_mutex);
+		for (size_t query_index = min(queries.size(), i * part_size); query_index < min(queries.size(), (i + 1) * part_size); ++query_index) {
+			workers_[i]->tasks.push_front({ &batch, query_index });
+			queued_count_.fetch_add(1, memory_order_relaxed);
+		}
+	}
+
+	unique_lock lock(state_mutex_);
+	start_cv_.notify_all();
+	finish_cv_.wait(lock, [&batch] { return batch.remaining_count.load(memory_order_acquire) == 0; });
+	if (batch.error) {
+		rethrow_exception(batch.error);
+	}
+}
+
+void BatchQueryExecutor::RunWorker(size_t worker_index)
+{
+	Worker& worker = *workers_[worker_index];
+	while (true) {
+		while (const auto task = PopTask(worker_index)) {
+			// очереди почти опустели - остальные потоки вот-вот начнут простаивать
+			const bool is_tail = queued_count_.load(memory_order_relaxed) < workers_.size();
+			if (!task->batch->is_failed.load(memory_order_relaxed)) {
+				try {
+					RunTask(worker, *task, is_tail);
+				}
+				catch (...) {
+					lock_guard guard(state_mutex_);
+					if (!task->batch->error) {
+						task->batch->error = current_exception();
+					}
+					task->batch->is_failed = true;
+				}
+			}
+			FinishTask(*task->batch);
+		}
+		// задачи кладутся в очереди до захвата state_mutex_ в Process, поэтому пробуждение не теряется
+		unique_lock lock(state_mutex_);
+		start_cv_.wait(lock, [this] { return stop_ || queued_count_.load(memory_order_relaxed) > 0; });
+		if (stop_) {
+			return;
+		}
+	}
+}
+
+std::optional<BatchQueryExecutor::Task> BatchQueryExecutor::PopTask(size_t worker_index)
+{
+	{
+		Worker& worker = *workers_[worker_index];
+		lock_guard guard(worker.tasks_mutex);
+		if (!worker.tasks.empty()) {
+			const Task task = worker.tasks.back();
+			worker.tasks.pop_back();
+			queued_count_.fetch_sub(1, memory_order_relaxed);
+			return task;
+		}
+	}
+	for (size_t offset = 1; offset < workers_.size(); ++offset) {
+		Worker& victim = *workers_[(worker_index + offset) % workers_.size()];
+		lock_guard guard(victim.tasks_mutex);
+		if (!victim.tasks.empty()) {
+			const Task task = victim.tasks.front();
+			victim.tasks.pop_front();
+			queued_count_.fetch_sub(1, memory_order_relaxed);
+			return task;
+		}
+	}
+	return nullopt;
+}
+
+void BatchQueryExecutor::RunTask(Worker& worker, const Task& task, bool is_tail)
+{
+	const Batch& batch = *task.batch;
+	const std::string& query = (*batch.queries)[task.query_index];
+	const bool is_parallel = split_tail_queries_ && is_tail;
+	if (!batch.on_result) {
+		Document* const slot = batch.output + task.query_index * batch.slot_size;
+		batch.counts[task.query_index] = is_parallel
+			? batch.search_server->FindTopDocuments(execution::par, worker.scratch, query, slot, DocumentStatus::ACTUAL, batch.slot_size)
+			: batch.search_server->FindTopDocuments(execution::seq, worker.scratch, query, slot, DocumentStatus::ACTUAL, batch.slot_size);
+		return;
+	}
+	auto documents = is_parallel
+		? batch.search_server->FindTopDocuments(execution::par, worker.scratch, query)
+		: batch.search_server->FindTopDocuments(execution::seq, worker.scratch, query);
+	(*batch.on_result)(task.query_index, move(documents));
+}
+
+void BatchQueryExecutor::FinishTask(Batch& batch)
+{
+	if (batch.remaining_count.fetch_sub(1, memory_order_acq_rel) == 1) {
+		// после уменьшения счётчика пакет может исчезнуть - дальше только мьютекс и условная переменная пула
+		lock_guard guard(state_mutex_);
+		finish_cv_.notify_all();
+	}
+}
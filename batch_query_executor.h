@@ -0,0 +1,96 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "search_server.h"
+
+// Пул потоков для пакетной обработки запросов FindTopDocuments с перехватом работы.
+// Номера запросов раскладываются по очередям потоков; поток берёт задачи с конца своей очереди,
+// а опустошив её, забирает с начала чужих - поток с тяжёлыми запросами не задерживает остальных.
+// У каждого потока свои буферы поиска (SearchServer::QueryScratch), они переиспользуются между запросами.
+// Когда очереди пусты и потоки начинают простаивать, оставшиеся запросы выполняются с execution::par,
+// чтобы последний тяжёлый запрос делился между свободными ядрами.
+// Пакеты из разных потоков не ждут друг друга: их задачи лежат в общих очередях и выполняются вперемешку.
+class BatchQueryExecutor {
+public:
+	// вызывается из рабочего потока сразу после выполнения запроса query_index
+	using ResultCallback = std::function<void(size_t query_index, std::vector<Document> documents)>;
+
+	// thread_count = 0 - по числу ядер
+	explicit BatchQueryExecutor(size_t thread_count = 0, bool split_tail_queries = true);
+	~BatchQueryExecutor();
+
+	BatchQueryExecutor(const BatchQueryExecutor&) = delete;
+	BatchQueryExecutor& operator=(const BatchQueryExecutor&) = delete;
+
+	// выполняет FindTopDocuments(queries[i]) для всех запросов и возвращается, когда все результаты отданы.
+	// результаты приходят в on_result в порядке готовности. Можно вызывать из нескольких потоков одновременно.
+	// если запрос выбросил исключение, необработанные запросы пропускаются, а исключение выбрасывается отсюда
+	void Process(const SearchServer& search_server, const std::vector<std::string>& queries,
+		const ResultCallback& on_result);
+
+	// как Process, но запрос i пишет не больше slot_size лучших документов сразу в output + i * slot_size,
+	// а их число - в counts[i]: ни вектора результата на запрос, ни обратного вызова
+	void ProcessInto(const SearchServer& search_server, const std::vector<std::string>& queries,
+		Document* output, size_t slot_size, size_t* counts);
+
+	size_t GetThreadCount() const {
+		return workers_.size();
+	}
+
+private:
+	// состояние одного вызова Process, живёт в его стеке
+	struct Batch {
+		const SearchServer* search_server;
+		const std::vector<std::string>* queries;
+		const ResultCallback* on_result = nullptr; // nullptr - результаты пишутся в output
+		Document* output = nullptr;
+		size_t slot_size = 0;
+		size_t* counts = nullptr;
+		std::atomic<size_t> remaining_count{ 0 }; // задач ещё не выполнено
+		std::atomic<bool> is_failed{ false };
+		std::exception_ptr error; // под state_mutex_
+	};
+
+	struct Task {
+		Batch* batch;
+		size_t query_index;
+	};
+
+	struct alignas(64) Worker {
+		std::deque<Task> tasks;
+		std::mutex tasks_mutex;
+		SearchServer::QueryScratch scratch;
+		std::thread thread;
+	};
+
+	std::vector<std::unique_ptr<Worker>> workers_;
+	const bool split_tail_queries_;
+
+	std::mutex state_mutex_;
+	std::condition_variable start_cv_;
+	std::condition_variable finish_cv_;
+	bool stop_ = false;
+
+	// задач в очередях всех потоков, меняется вместе с очередью под её мьютексом
+	std::atomic<size_t> queued_count_{ 0 };
+
+	// раскладывает задачи пакета по очередям и ждёт их выполнения
+	void Run(Batch& batch);
+	void RunWorker(size_t worker_index);
+	// своя задача с конца очереди или чужая с начала; nullopt, если задач не осталось
+	std::optional<Task> PopTask(size_t worker_index);
+	void RunTask(Worker& worker, const Task& task, bool is_tail);
+	// задача выполнена или пропущена; последняя задача пакета будит его Process
+	void FinishTask(Batch& batch);
+};
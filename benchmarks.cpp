@@ -0,0 +1,196 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <execution>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+#include "corpus_generator.h"
+#include "process_queries.h"
+#include "search_server.h"
+#include "string_processing.h"
+
+// Замеры на случайных корпусах. Аргументы бенчмарка: число документов, размер словаря, слов в запросе.
+// Документы - по DOCUMENT_WORD_COUNT слов из того же словаря. Корпус строится один раз на набор аргументов.
+// Результаты для отслеживания регрессий: search_server_benchmarks --benchmark_out=result.json --benchmark_out_format=json
+
+using namespace std;
+
+namespace {
+
+constexpr int DOCUMENT_WORD_COUNT = 70;
+constexpr int MAX_WORD_LENGTH = 10;
+constexpr int QUERY_COUNT = 1000;
+const string STOP_WORDS = "and with"s;
+
+struct Corpus {
+	vector<string> dictionary;
+	vector<string> documents;
+	vector<string> queries;
+	unique_ptr<SearchServer> search_server;
+};
+
+void FillServer(SearchServer& search_server, const vector<string>& documents)
+{
+	for (size_t i = 0; i < documents.size(); ++i) {
+		search_server.AddDocument(static_cast<int>(i), documents[i], DocumentStatus::ACTUAL, { 1, 2, 3 });
+	}
+}
+
+const Corpus& GetCorpus(const benchmark::State& state)
+{
+	static map<tuple<int64_t, int64_t, int64_t>, Corpus> corpora;
+	const auto key = make_tuple(state.range(0), state.range(1), state.range(2));
+	auto it = corpora.find(key);
+	if (it == corpora.end()) {
+		// одно и то же зерно - один и тот же корпус от запуска к запуску
+		mt19937 generator;
+		Corpus corpus;
+		corpus.dictionary = GenerateDictionary(generator, static_cast<int>(state.range(1)), MAX_WORD_LENGTH);
+		corpus.documents = GenerateQueries(generator, corpus.dictionary, static_cast<int>(state.range(0)), DOCUMENT_WORD_COUNT);
+		corpus.queries = GenerateQueries(generator, corpus.dictionary, QUERY_COUNT, static_cast<int>(state.range(2)));
+		corpus.search_server = make_unique<SearchServer>(STOP_WORDS);
+		FillServer(*corpus.search_server, corpus.documents);
+		it = corpora.emplace(key, move(corpus)).first;
+	}
+	return it->second;
+}
+
+void CorpusArguments(benchmark::internal::Benchmark* benchmark)
+{
+	benchmark->ArgNames({ "documents", "vocabulary", "query_words" });
+	benchmark->Args({ 1'000, 1'000, 5 });
+	benchmark->Args({ 10'000, 1'000, 5 });
+	benchmark->Args({ 10'000, 10'000, 5 });
+	benchmark->Args({ 10'000, 1'000, 20 });
+	benchmark->Args({ 10'000, 10'000, 70 });
+}
+
+void BM_AddDocument(benchmark::State& state)
+{
+	const Corpus& corpus = GetCorpus(state);
+	for (auto _ : state) {
+		SearchServer search_server(STOP_WORDS);
+		FillServer(search_server, corpus.documents);
+		benchmark::DoNotOptimize(search_server.GetDocumentCount());
+	}
+	state.SetItemsProcessed(state.iterations() * corpus.documents.size());
+}
+
+template <typename ExecutionPolicy>
+void BM_FindTopDocuments(benchmark::State& state, ExecutionPolicy policy)
+{
+	const Corpus& corpus = GetCorpus(state);
+	size_t query_index = 0;
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(corpus.search_server->FindTopDocuments(policy, corpus.queries[query_index]));
+		query_index = (query_index + 1) % corpus.queries.size();
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+
+template <typename ExecutionPolicy>
+void BM_MatchDocument(benchmark::State& state, ExecutionPolicy policy)
+{
+	const Corpus& corpus = GetCorpus(state);
+	mt19937 generator;
+	uniform_int_distribution<int> document_id(0, static_cast<int>(corpus.documents.size()) - 1);
+	size_t query_index = 0;
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(corpus.search_server->MatchDocument(policy, corpus.queries[query_index], document_id(generator)));
+		query_index = (query_index + 1) % corpus.queries.size();
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+
+// удаление по одному документу в случайном порядке, в том числе уплотнения, которые оно вызывает;
+// когда документы кончаются, сервер наполняется заново вне замера
+void BM_RemoveDocument(benchmark::State& state)
+{
+	const Corpus& corpus = GetCorpus(state);
+	vector<int> document_ids(corpus.documents.size());
+	for (size_t i = 0; i < document_ids.size(); ++i) {
+		document_ids[i] = static_cast<int>(i);
+	}
+	shuffle(document_ids.begin(), document_ids.end(), mt19937());
+	unique_ptr<SearchServer> search_server;
+	size_t removed_count = document_ids.size();
+	for (auto _ : state) {
+		if (removed_count == document_ids.size()) {
+			state.PauseTiming();
+			search_server = make_unique<SearchServer>(STOP_WORDS);
+			FillServer(*search_server, corpus.documents);
+			removed_count = 0;
+			state.ResumeTiming();
+		}
+		search_server->RemoveDocument(document_ids[removed_count++]);
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+
+void BM_ProcessQueries(benchmark::State& state)
+{
+	const Corpus& corpus = GetCorpus(state);
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(ProcessQueries(*corpus.search_server, corpus.queries));
+	}
+	state.SetItemsProcessed(state.iterations() * corpus.queries.size());
+}
+
+void BM_ProcessQueriesJoined(benchmark::State& state)
+{
+	const Corpus& corpus = GetCorpus(state);
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(ProcessQueriesJoined(*corpus.search_server, corpus.queries));
+	}
+	state.SetItemsProcessed(state.iterations() * corpus.queries.size());
+}
+
+void BM_SplitIntoWordsView(benchmark::State& state)
+{
+	const Corpus& corpus = GetCorpus(state);
+	size_t bytes = 0;
+	for (auto _ : state) {
+		for (const string& document : corpus.documents) {
+			benchmark::DoNotOptimize(SplitIntoWordsView(document));
+			bytes += document.size();
+		}
+	}
+	state.SetBytesProcessed(bytes);
+}
+
+void BM_SplitIntoWordsChecked(benchmark::State& state)
+{
+	const Corpus& corpus = GetCorpus(state);
+	vector<string_view> words;
+	size_t bytes = 0;
+	for (auto _ : state) {
+		for (const string& document : corpus.documents) {
+			words.clear();
+			benchmark::DoNotOptimize(SplitIntoWordsChecked(document, words));
+			bytes += document.size();
+		}
+	}
+	state.SetBytesProcessed(bytes);
+}
+
+} // namespace
+
+// параллельные замеры - по настенному времени: процессорное время главного потока не учитывает пул
+BENCHMARK(BM_AddDocument)->Apply(CorpusArguments)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_FindTopDocuments, seq, execution::seq)->Apply(CorpusArguments)->Unit(benchmark::kMicrosecond);
+BENCHMARK_CAPTURE(BM_FindTopDocuments, par, execution::par)->Apply(CorpusArguments)->Unit(benchmark::kMicrosecond)->UseRealTime();
+BENCHMARK_CAPTURE(BM_MatchDocument, seq, execution::seq)->Apply(CorpusArguments)->Unit(benchmark::kMicrosecond);
+BENCHMARK_CAPTURE(BM_MatchDocument, par, execution::par)->Apply(CorpusArguments)->Unit(benchmark::kMicrosecond)->UseRealTime();
+BENCHMARK(BM_RemoveDocument)->Apply(CorpusArguments)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_ProcessQueries)->Apply(CorpusArguments)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(BM_ProcessQueriesJoined)->Apply(CorpusArguments)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(BM_SplitIntoWordsView)->Apply(CorpusArguments)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_SplitIntoWordsChecked)->Apply(CorpusArguments)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -1,61 +1,262 @@
 #pragma once
 
 #include <cstdlib>
+#include <cstdint>
 #include <map>
 #include <mutex>
+#include <shared_mutex>
+#include <optional>
 #include <string>
 #include <vector>
+#include <numeric>
+#include <algorithm>
+#include <execution>
+#include <functional>
 
 
 using namespace std::string_literals;
 
-template <typename Key, typename Value>
+// Потокобезопасный словарь, разбитый на сегменты (shards).
+// Каждый сегмент - хеш-таблица с открытой адресацией и линейным пробированием под своей блокировкой.
+// Сегменты выровнены по строке кеша, чтобы блокировки соседних сегментов не делили одну строку.
+// Ключ может быть любым хешируемым типом, в том числе std::string_view
+// (строки, на которые ссылаются ключи string_view, должны жить дольше словаря).
+// Чтение берёт разделяемую блокировку сегмента, запись - исключительную.
+// SearchServer::AddDocuments раскладывает в нём записи пакета по словам из нескольких потоков.
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
 class ConcurrentMap {
 private:
-	struct Bucket {
-		std::mutex mutex;
-		std::map<Key, Value> map;
+	// хеш-таблица одного сегмента, используется только под блокировкой сегмента
+	class Table {
+	public:
+		const Value* Find(const Key& key, uint64_t hash) const {
+			const Slot* slot = FindSlot(key, hash);
+			return slot != nullptr ? &slot->value : nullptr;
+		}
+
+		Value& FindOrInsert(const Key& key, uint64_t hash) {
+			if (Slot* slot = const_cast<Slot*>(FindSlot(key, hash))) {
+				return slot->value;
+			}
+			// заполненность вместе с удалёнными ячейками не больше 3/4,
+			// если большая часть занятого - удалённые ячейки, таблица перестраивается без роста
+			if ((used_ + 1) * 4 > slots_.size() * 3) {
+				Rehash(std::max<size_t>(16, (size_ + 1) * 2 > slots_.size() ? slots_.size() * 2 : slots_.size()));
+			}
+			for (size_t i = hash & mask(); ; i = (i + 1) & mask()) {
+				Slot& slot = slots_[i];
+				if (slot.state != SlotState::FULL) {
+					if (slot.state == SlotState::EMPTY) {
+						++used_;
+					}
+					slot = Slot{ SlotState::FULL, hash, key, Value{} };
+					++size_;
+					return slot.value;
+				}
+			}
+		}
+
+		bool Erase(const Key& key, uint64_t hash) {
+			Slot* slot = const_cast<Slot*>(FindSlot(key, hash));
+			if (slot == nullptr) {
+				return false;
+			}
+			slot->state = SlotState::DELETED;
+			slot->key = Key{};
+			slot->value = Value{};
+			--size_;
+			return true;
+		}
+
+		size_t size() const {
+			return size_;
+		}
+
+		template <typename Action>
+		void ForEach(Action action) const {
+			for (const Slot& slot : slots_) {
+				if (slot.state == SlotState::FULL) {
+					action(slot.key, slot.value);
+				}
+			}
+		}
+
+	private:
+		enum class SlotState : uint8_t {
+			EMPTY,
+			FULL,
+			DELETED
+		};
+		struct Slot {
+			SlotState state = SlotState::EMPTY;
+			uint64_t hash = 0;
+			Key key{};
+			Value value{};
+		};
+		std::vector<Slot> slots_;
+		size_t size_ = 0; // занятые ячейки
+		size_t used_ = 0; // занятые и удалённые ячейки
+
+		size_t mask() const {
+			return slots_.size() - 1;
+		}
+
+		const Slot* FindSlot(const Key& key, uint64_t hash) const {
+			if (slots_.empty()) {
+				return nullptr;
+			}
+			for (size_t i = hash & mask(); ; i = (i + 1) & mask()) {
+				const Slot& slot = slots_[i];
+				if (slot.state == SlotState::EMPTY) {
+					return nullptr;
+				}
+				if (slot.state == SlotState::FULL && slot.hash == hash && slot.key == key) {
+					return &slot;
+				}
+			}
+		}
+
+		// размер таблицы - степень двойки
+		void Rehash(size_t new_size) {
+			std::vector<Slot> old_slots(new_size);
+			old_slots.swap(slots_);
+			used_ = size_;
+			for (Slot& old_slot : old_slots) {
+				if (old_slot.state != SlotState::FULL) {
+					continue;
+				}
+				size_t i = old_slot.hash & mask();
+				while (slots_[i].state == SlotState::FULL) {
+					i = (i + 1) & mask();
+				}
+				slots_[i] = std::move(old_slot);
+			}
+		}
 	};
 
-public:
-	static_assert(std::is_integral_v<Key>, "ConcurrentMap supports only integer keys"s);
+	struct alignas(64) Shard {
+		mutable std::shared_mutex mutex;
+		Table table;
+	};
 
+public:
 	struct Access {
-		std::lock_guard<std::mutex> guard;
+		std::lock_guard<std::shared_mutex> guard;
 		Value& ref_to_value;
 
-		Access(const Key& key, Bucket& bucket)
-			: guard(bucket.mutex)
-			, ref_to_value(bucket.map[key]) {
+		Access(const Key& key, uint64_t hash, Shard& shard)
+			: guard(shard.mutex)
+			, ref_to_value(shard.table.FindOrInsert(key, hash)) {
 		}
 	};
 
 	explicit ConcurrentMap(size_t bucket_count)
-		: buckets_(bucket_count) {
+		: shards_(std::max<size_t>(bucket_count, 1)) {
 	}
 
+	// доступ к значению по ключу, при отсутствии ключа вставляет Value{}
 	Access operator[](const Key& key);
 
+	// копия значения без вставки; читатели одного сегмента не блокируют друг друга
+	std::optional<Value> Find(const Key& key) const;
+
+	// возвращает количество удалённых элементов (0 или 1)
+	size_t Erase(const Key& key);
+
+	size_t size() const;
+
+	// сегменты копируются параллельно, затем элементы сортируются и собираются в map за линейное время
 	std::map<Key, Value> BuildOrdinaryMap();
 
 private:
-	std::vector<Bucket> buckets_;
+	std::vector<Shard> shards_;
+	Hash hasher_;
+
+	// перемешивание битов: std::hash для целых чисел - тождественная функция
+	uint64_t ComputeHash(const Key& key) const {
+		uint64_t hash = static_cast<uint64_t>(hasher_(key)) + 0x9e3779b97f4a7c15ull;
+		hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9ull;
+		hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebull;
+		return hash ^ (hash >> 31);
+	}
+
+	// старшие биты хеша выбирают сегмент, младшие - ячейку внутри сегмента
+	Shard& GetShard(uint64_t hash) {
+		return shards_[(hash >> 32) % shards_.size()];
+	}
+
+	const Shard& GetShard(uint64_t hash) const {
+		return shards_[(hash >> 32) % shards_.size()];
+	}
 };
 
-template<typename Key, typename Value>
-typename ConcurrentMap<Key, Value>::Access
-ConcurrentMap<Key, Value>::operator[](const Key &key) 
+template<typename Key, typename Value, typename Hash>
+typename ConcurrentMap<Key, Value, Hash>::Access
+ConcurrentMap<Key, Value, Hash>::operator[](const Key &key)
+{
+	const uint64_t hash = ComputeHash(key);
+	return { key, hash, GetShard(hash) };
+}
+
+template<typename Key, typename Value, typename Hash>
+std::optional<Value> ConcurrentMap<Key, Value, Hash>::Find(const Key& key) const
+{
+	const uint64_t hash = ComputeHash(key);
+	const Shard& shard = GetShard(hash);
+	std::shared_lock guard(shard.mutex);
+	if (const Value* value = shard.table.Find(key, hash)) {
+		return *value;
+	}
+	return std::nullopt;
+}
+
+template<typename Key, typename Value, typename Hash>
+size_t ConcurrentMap<Key, Value, Hash>::Erase(const Key& key)
 {
-	auto& bucket = buckets_[static_cast<uint64_t>(key) % buckets_.size()];
-	return { key, bucket };
+	const uint64_t hash = ComputeHash(key);
+	Shard& shard = GetShard(hash);
+	std::lock_guard guard(shard.mutex);
+	return shard.table.Erase(key, hash) ? 1 : 0;
 }
 
-template<typename Key, typename Value>
-std::map<Key, Value> ConcurrentMap<Key, Value>::BuildOrdinaryMap() {
+template<typename Key, typename Value, typename Hash>
+size_t ConcurrentMap<Key, Value, Hash>::size() const
+{
+	size_t result = 0;
+	for (const Shard& shard : shards_) {
+		std::shared_lock guard(shard.mutex);
+		result += shard.table.size();
+	}
+	return result;
+}
+
+template<typename Key, typename Value, typename Hash>
+std::map<Key, Value> ConcurrentMap<Key, Value, Hash>::BuildOrdinaryMap() {
+	std::vector<std::vector<std::pair<Key, Value>>> shard_items(shards_.size());
+	std::vector<size_t> indexes(shards_.size());
+	std::iota(indexes.begin(), indexes.end(), 0);
+	std::for_each(std::execution::par,
+		indexes.begin(), indexes.end(),
+		[&](size_t index) {
+		const Shard& shard = shards_[index];
+		std::shared_lock guard(shard.mutex);
+		auto& items = shard_items[index];
+		items.reserve(shard.table.size());
+		shard.table.ForEach([&items](const Key& key, const Value& value) {
+			items.emplace_back(key, value);
+		});
+	});
+
+	std::vector<std::pair<Key, Value>> items;
+	for (auto& part : shard_items) {
+		std::move(part.begin(), part.end(), std::back_inserter(items));
+	}
+	std::sort(std::execution::par, items.begin(), items.end(),
+		[](const auto& lhs, const auto& rhs) { return lhs.first < rhs.first; });
+
 	std::map<Key, Value> result;
-	for (auto&[mutex, map] : buckets_) {
-		std::lock_guard g(mutex);
-		result.insert(map.begin(), map.end());
+	for (auto& item : items) {
+		result.emplace_hint(result.end(), std::move(item));
 	}
 	return result;
-}
\ No newline at end of file
+}
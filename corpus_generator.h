@@ -0,0 +1,20 @@
+#pragma once
+#include <random>
+#include <string>
+#include <vector>
+
+// генераторы случайных корпусов для замеров производительности (main.cpp, benchmarks.cpp)
+
+// слово из строчных латинских букв длиной от 1 до max_length
+std::string GenerateWord(std::mt19937& generator, int max_length);
+
+// до word_count слов, соседние повторы убраны
+std::vector<std::string> GenerateDictionary(std::mt19937& generator, int word_count, int max_length);
+
+// word_count слов из словаря через пробел, каждое с вероятностью minus_prob - минус-слово
+std::string GenerateQuery(std::mt19937& generator, const std::vector<std::string>& dictionary, int word_count,
+	double minus_prob = 0);
+
+// query_count запросов по max_word_count слов; годится и для генерации текстов документов
+std::vector<std::string> GenerateQueries(std::mt19937& generator, const std::vector<std::string>& dictionary,
+	int query_count, int max_word_count);
@@ -1,5 +1,7 @@
 #pragma once
 #include <ostream>
+#include <string_view>
+#include <vector>
 
 struct Document {
 	Document() = default;
@@ -22,3 +24,11 @@ enum class DocumentStatus {
 	BANNED,
 	REMOVED
 };
+
+// документ для пакетного добавления в поисковый сервер
+struct RawDocument {
+	int id = 0;
+	std::string_view text;
+	DocumentStatus status = DocumentStatus::ACTUAL;
+	std::vector<int> ratings;
+};
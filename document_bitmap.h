@@ -0,0 +1,38 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Плотное множество порядковых номеров документов: бит на документ, 64 документа в слове.
+// Номера за пределами заполненной части считаются отсутствующими.
+class DocumentBitmap {
+public:
+	static constexpr size_t WORD_BITS = 64;
+
+	void Set(int ordinal) {
+		const size_t index = static_cast<size_t>(ordinal) / WORD_BITS;
+		if (index >= words_.size()) {
+			words_.resize(index + 1, 0);
+		}
+		words_[index] |= uint64_t{ 1 } << (ordinal % WORD_BITS);
+	}
+
+	void Reset(int ordinal) {
+		const size_t index = static_cast<size_t>(ordinal) / WORD_BITS;
+		if (index < words_.size()) {
+			words_[index] &= ~(uint64_t{ 1 } << (ordinal % WORD_BITS));
+		}
+	}
+
+	bool Test(int ordinal) const {
+		return (GetWord(static_cast<size_t>(ordinal) / WORD_BITS) >> (ordinal % WORD_BITS)) & 1;
+	}
+
+	// слово с битами номеров [index * 64, index * 64 + 64)
+	uint64_t GetWord(size_t index) const {
+		return index < words_.size() ? words_[index] : 0;
+	}
+
+private:
+	std::vector<uint64_t> words_;
+};
@@ -0,0 +1,91 @@
+#include "document_text_store.h"
+
+#include <stdexcept>
+
+using namespace std;
+
+DocumentTextStore::DocumentTextStore(Mode mode, const std::string& path)
+	: mode_(mode)
+{
+	if (mode_ == Mode::FILE) {
+		file_ = make_unique<File>();
+		file_->stream.open(path, ios::in | ios::out | ios::binary | ios::trunc);
+		if (!file_->stream) {
+			throw runtime_error("Cannot open text store "s + path);
+		}
+	}
+}
+
+DocumentTextStore::DocumentTextStore(std::string_view mapped)
+	: mapped_(mapped)
+{
+}
+
+DocumentTextStore::TextRef DocumentTextStore::Add(std::string_view text)
+{
+	switch (mode_) {
+	case Mode::MEMORY: {
+		const TextRef ref{ mapped_.size() + blob_.size(), text.size() };
+		blob_.append(text);
+		return ref;
+	}
+	case Mode::FILE: {
+		lock_guard guard(file_->mutex);
+		const TextRef ref{ file_->size, text.size() };
+		file_->stream.clear();
+		file_->stream.seekp(static_cast<streamoff>(file_->size));
+		file_->stream.write(text.data(), static_cast<streamsize>(text.size()));
+		if (!file_->stream) {
+			throw runtime_error("Cannot write text store"s);
+		}
+		file_->size += text.size();
+		return ref;
+	}
+	default:
+		return {};
+	}
+}
+
+std::string DocumentTextStore::Get(TextRef ref) const
+{
+	switch (mode_) {
+	case Mode::MEMORY:
+		return std::string(GetMemoryText(ref));
+	case Mode::FILE: {
+		string text(ref.size, '\0');
+		lock_guard guard(file_->mutex);
+		file_->stream.clear();
+		file_->stream.seekg(static_cast<streamoff>(ref.offset));
+		file_->stream.read(text.data(), static_cast<streamsize>(ref.size));
+		if (!file_->stream) {
+			throw runtime_error("Cannot read text store"s);
+		}
+		return text;
+	}
+	default:
+		return {};
+	}
+}
+
+void DocumentTextStore::Compact(std::vector<TextRef>& refs)
+{
+	if (mode_ != Mode::MEMORY) {
+		return;
+	}
+	string blob;
+	for (TextRef& ref : refs) {
+		const TextRef new_ref{ blob.size(), ref.size };
+		blob.append(GetMemoryText(ref));
+		ref = new_ref;
+	}
+	blob_ = move(blob);
+	mapped_ = {};
+}
+
+std::string_view DocumentTextStore::GetMemoryText(TextRef ref) const
+{
+	if (ref.offset < mapped_.size()) {
+		return mapped_.substr(ref.offset, ref.size);
+	}
+	return std::string_view(blob_).substr(ref.offset - mapped_.size(), ref.size);
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Хранилище текстов документов. Тексты только дописываются в конец общего блока и адресуются TextRef,
+// поэтому на документ тратится 16 байт ссылки, а не отдельная строка в куче.
+// MEMORY - блок в памяти процесса, FILE - в файле на диске, текст читается с диска по запросу,
+// NONE - тексты не сохраняются, Get возвращает пустую строку.
+// В MEMORY начало блока может лежать в отображённом файле индекса: новые тексты дописываются в память за ним,
+// а Compact копирует оставшиеся тексты к себе.
+class DocumentTextStore {
+public:
+	enum class Mode {
+		MEMORY,
+		FILE,
+		NONE
+	};
+
+	struct TextRef {
+		uint64_t offset = 0;
+		uint64_t size = 0;
+	};
+
+	DocumentTextStore() = default;
+
+	// для FILE файл path создаётся заново
+	explicit DocumentTextStore(Mode mode, const std::string& path = {});
+
+	// MEMORY, начало блока - mapped без копирования; память должна жить дольше хранилища
+	explicit DocumentTextStore(std::string_view mapped);
+
+	Mode GetMode() const {
+		return mode_;
+	}
+
+	TextRef Add(std::string_view text);
+
+	// для FILE можно вызывать из нескольких потоков
+	std::string Get(TextRef ref) const;
+
+	// в памяти переписывает блок только с текстами refs и обновляет ссылки; файл не уплотняется
+	void Compact(std::vector<TextRef>& refs);
+
+private:
+	// текст MEMORY без копирования
+	std::string_view GetMemoryText(TextRef ref) const;
+
+	struct File {
+		std::fstream stream;
+		uint64_t size = 0;
+		std::mutex mutex;
+	};
+
+	Mode mode_ = Mode::MEMORY;
+	std::string_view mapped_;    // MEMORY, тексты со смещениями до mapped_.size()
+	std::string blob_;           // MEMORY, остальные тексты
+	std::unique_ptr<File> file_; // FILE
+};
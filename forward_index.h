@@ -0,0 +1,128 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <memory_resource>
+
+#include "inverted_index.h"
+
+// Прямой индекс: порядковый номер документа -> (номер слова, номер частоты) по возрастанию номера слова.
+// Первые документы могут читаться прямо из отображённого файла индекса. Слова такого документа копируются
+// к себе, только когда документ меняется, а все сразу - перед перенумерацией документов.
+class ForwardIndex {
+public:
+	// раскладка совпадает с файлом индекса
+	struct TermFreq {
+		InvertedIndex::TermId term_id;
+		InvertedIndex::FreqCode freq_code;
+
+		bool operator<(const TermFreq& other) const {
+			return term_id < other.term_id;
+		}
+	};
+	using TermFreqs = std::pmr::vector<TermFreq>;
+
+	// слова документа только для чтения
+	class Terms {
+	public:
+		Terms(const TermFreq* begin, const TermFreq* end)
+			: begin_(begin)
+			, end_(end) {
+		}
+
+		const TermFreq* begin() const {
+			return begin_;
+		}
+
+		const TermFreq* end() const {
+			return end_;
+		}
+
+		size_t size() const {
+			return static_cast<size_t>(end_ - begin_);
+		}
+
+	private:
+		const TermFreq* begin_;
+		const TermFreq* end_;
+	};
+
+	explicit ForwardIndex(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+		: owned_(resource) {
+	}
+
+	// документы [0, document_count) читаются из terms по границам offsets (document_count + 1 значение).
+	// память должна жить дольше индекса
+	void Map(const TermFreq* terms, const uint64_t* offsets, size_t document_count) {
+		mapped_terms_ = terms;
+		mapped_offsets_ = offsets;
+		mapped_count_ = document_count;
+		detached_.assign(document_count, 0);
+		owned_.clear();
+		owned_.resize(document_count);
+	}
+
+	// копирует к себе все документы из файла
+	void Unmap() {
+		for (size_t ordinal = 0; ordinal < mapped_count_; ++ordinal) {
+			Edit(static_cast<int>(ordinal));
+		}
+		mapped_terms_ = nullptr;
+		mapped_offsets_ = nullptr;
+		mapped_count_ = 0;
+		detached_.clear();
+	}
+
+	size_t size() const {
+		return owned_.size();
+	}
+
+	// новый документ без слов
+	void emplace_back() {
+		owned_.emplace_back();
+	}
+
+	// уменьшать размер можно только после Unmap
+	void resize(size_t document_count) {
+		owned_.resize(document_count);
+	}
+
+	Terms Get(int ordinal) const {
+		if (IsMapped(ordinal)) {
+			return { mapped_terms_ + mapped_offsets_[ordinal], mapped_terms_ + mapped_offsets_[ordinal + 1] };
+		}
+		const TermFreqs& terms = owned_[ordinal];
+		return { terms.data(), terms.data() + terms.size() };
+	}
+
+	// слова документа для изменения, документ из файла сначала копируется.
+	// разные документы можно менять из разных потоков
+	TermFreqs& Edit(int ordinal) {
+		if (IsMapped(ordinal)) {
+			const Terms terms = Get(ordinal);
+			owned_[ordinal].assign(terms.begin(), terms.end());
+			detached_[ordinal] = 1;
+		}
+		return owned_[ordinal];
+	}
+
+	// убирает слова документа и освобождает их память
+	void Clear(int ordinal) {
+		owned_[ordinal] = TermFreqs(owned_.get_allocator().resource());
+		if (static_cast<size_t>(ordinal) < mapped_count_) {
+			detached_[ordinal] = 1;
+		}
+	}
+
+private:
+	std::pmr::vector<TermFreqs> owned_;
+	const TermFreq* mapped_terms_ = nullptr;
+	const uint64_t* mapped_offsets_ = nullptr;
+	size_t mapped_count_ = 0;
+	// документ из файла уже скопирован или очищен; байт, а не бит - соседние документы меняются из разных потоков
+	std::vector<uint8_t> detached_;
+
+	bool IsMapped(int ordinal) const {
+		return static_cast<size_t>(ordinal) < mapped_count_ && !detached_[ordinal];
+	}
+};
@@ -0,0 +1,367 @@
+#include "index_file.h"
+#include "search_server.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define INDEX_FILE_HAS_MMAP 1
+#endif
+
+using namespace std;
+
+namespace index_file {
+
+MappedFile::MappedFile(const std::string& path)
+{
+#ifdef INDEX_FILE_HAS_MMAP
+	const int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		throw runtime_error("Cannot open index file "s + path);
+	}
+	struct stat file_stat;
+	if (fstat(fd, &file_stat) != 0) {
+		close(fd);
+		throw runtime_error("Cannot read index file "s + path);
+	}
+	size_ = static_cast<size_t>(file_stat.st_size);
+	if (size_ > 0) {
+		void* data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (data == MAP_FAILED) {
+			close(fd);
+			throw runtime_error("Cannot map index file "s + path);
+		}
+		data_ = static_cast<const char*>(data);
+		mapped_ = true;
+	}
+	close(fd);
+#else
+	ifstream in(path, ios::binary);
+	if (!in) {
+		throw runtime_error("Cannot open index file "s + path);
+	}
+	buffer_.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+	data_ = buffer_.data();
+	size_ = buffer_.size();
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+#ifdef INDEX_FILE_HAS_MMAP
+	if (mapped_) {
+		munmap(const_cast<char*>(data_), size_);
+	}
+#endif
+}
+
+// сбрасывает на диск данные файла или записи каталога; без POSIX ничего не делает
+void SyncToDisk(const std::string& path)
+{
+#ifdef INDEX_FILE_HAS_MMAP
+	const int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		throw runtime_error("Cannot open for sync "s + path);
+	}
+	const int result = fsync(fd);
+	close(fd);
+	if (result != 0) {
+		throw runtime_error("Cannot sync "s + path);
+	}
+#endif
+}
+
+} // namespace index_file
+
+static_assert(sizeof(InvertedIndex::PostingList::Block) == 16, "index file block layout changed");
+static_assert(sizeof(ForwardIndex::TermFreq) == 8, "index file forward index layout changed");
+static_assert(sizeof(DocumentTextStore::TextRef) == sizeof(index_file::StringRef), "index file text layout changed");
+
+void SearchServer::Save(const std::string& path) const
+{
+	using namespace index_file;
+
+	string strings;
+	const auto add_string = [&strings](string_view str) {
+		const StringRef ref{ strings.size(), str.size() };
+		strings.append(str);
+		return ref;
+	};
+
+	vector<StringRef> stop_words;
+	stop_words.reserve(stop_words_.size());
+	for (const string& word : stop_words_) {
+		stop_words.push_back(add_string(word));
+	}
+
+	const size_t ordinal_count = ordinal_to_id_.size();
+	vector<int32_t> statuses(ordinal_count);
+	vector<StringRef> text_refs(ordinal_count);
+	vector<uint64_t> document_term_offsets(ordinal_count + 1, 0);
+	for (size_t ordinal = 0; ordinal < ordinal_count; ++ordinal) {
+		statuses[ordinal] = static_cast<int32_t>(statuses_[ordinal]);
+		text_refs[ordinal] = add_string(text_store_.Get(text_refs_[ordinal]));
+		document_term_offsets[ordinal + 1] = document_term_offsets[ordinal]
+			+ ordinal_to_terms_.Get(static_cast<int>(ordinal)).size();
+	}
+
+	vector<int32_t> document_ordinals;
+	document_ordinals.reserve(document_ids_.size());
+	for (const int document_id : document_ids_) {
+		document_ordinals.push_back(id_to_ordinal_.at(document_id));
+	}
+
+	vector<double> term_freqs(word_to_document_.GetTermFreqCount());
+	for (size_t freq_code = 0; freq_code < term_freqs.size(); ++freq_code) {
+		term_freqs[freq_code] = word_to_document_.GetTermFreq(static_cast<InvertedIndex::FreqCode>(freq_code));
+	}
+
+	// списки пишутся как есть, вместе с записями удалённых, но ещё не убранных Compact документов
+	vector<TermRecord> terms;
+	vector<const InvertedIndex::PostingList*> term_postings;
+	terms.reserve(word_to_document_.GetTermCount());
+	term_postings.reserve(word_to_document_.GetTermCount());
+	uint64_t block_count = 0;
+	uint64_t data_size = 0;
+	word_to_document_.ForEachTerm([&](InvertedIndex::TermId term_id, string_view word, const InvertedIndex::PostingList& postings) {
+		terms.push_back({ add_string(word), block_count, postings.GetBlockCount(), data_size, postings.GetDataSize(),
+			postings.GetEntryCount(), postings.GetRemovedCount(), word_to_document_.GetMaxTermFreq(term_id) });
+		term_postings.push_back(&postings);
+		block_count += postings.GetBlockCount();
+		data_size += postings.GetDataSize();
+	});
+
+	Header header{};
+	memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.version = VERSION;
+	header.byte_order_mark = BYTE_ORDER_MARK;
+	uint64_t offset = sizeof(Header);
+	const auto place = [&offset](Section& section, size_t count, size_t item_size) {
+		section = { offset, count };
+		offset += (count * item_size + 7) / 8 * 8;
+	};
+	place(header.stop_words, stop_words.size(), sizeof(StringRef));
+	place(header.ordinal_to_id, ordinal_count, sizeof(int32_t));
+	place(header.ratings, ordinal_count, sizeof(int32_t));
+	place(header.statuses, ordinal_count, sizeof(int32_t));
+	place(header.text_refs, ordinal_count, sizeof(StringRef));
+	place(header.document_ordinals, document_ordinals.size(), sizeof(int32_t));
+	place(header.term_freqs, term_freqs.size(), sizeof(double));
+	place(header.terms, terms.size(), sizeof(TermRecord));
+	place(header.posting_blocks, block_count, sizeof(InvertedIndex::PostingList::Block));
+	place(header.posting_data, data_size, sizeof(uint8_t));
+	place(header.document_term_offsets, document_term_offsets.size(), sizeof(uint64_t));
+	place(header.document_terms, document_term_offsets.back(), sizeof(ForwardIndex::TermFreq));
+	place(header.strings, strings.size(), sizeof(char));
+
+	// пишем во временный файл, сбрасываем его на диск и подменяем им старый, затем сбрасываем каталог:
+	// ни сбой процесса, ни отключение питания не оставляют под именем path недописанный индекс
+	const string temp_path = path + ".tmp"s;
+	ofstream out(temp_path, ios::binary | ios::trunc);
+	if (!out) {
+		throw runtime_error("Cannot open index file "s + temp_path);
+	}
+	// секция может писаться по частям, end_section дополняет её до 8 байт
+	uint64_t section_size = 0;
+	const auto write = [&out, &section_size](const void* data, size_t size) {
+		out.write(static_cast<const char*>(data), size);
+		section_size += size;
+	};
+	const auto end_section = [&out, &section_size]() {
+		static const char padding[8] = {};
+		out.write(padding, (8 - section_size % 8) % 8);
+		section_size = 0;
+	};
+	const auto write_section = [&](const void* data, size_t size) {
+		write(data, size);
+		end_section();
+	};
+	static_assert(sizeof(int) == sizeof(int32_t), "document columns are written as int32_t");
+	write_section(&header, sizeof(header));
+	write_section(stop_words.data(), stop_words.size() * sizeof(StringRef));
+	write_section(ordinal_to_id_.data(), ordinal_count * sizeof(int32_t));
+	write_section(ratings_.data(), ordinal_count * sizeof(int32_t));
+	write_section(statuses.data(), ordinal_count * sizeof(int32_t));
+	write_section(text_refs.data(), ordinal_count * sizeof(StringRef));
+	write_section(document_ordinals.data(), document_ordinals.size() * sizeof(int32_t));
+	write_section(term_freqs.data(), term_freqs.size() * sizeof(double));
+	write_section(terms.data(), terms.size() * sizeof(TermRecord));
+	for (const InvertedIndex::PostingList* postings : term_postings) {
+		write(postings->GetBlocks(), postings->GetBlockCount() * sizeof(InvertedIndex::PostingList::Block));
+	}
+	end_section();
+	for (const InvertedIndex::PostingList* postings : term_postings) {
+		write(postings->GetData(), postings->GetDataSize());
+	}
+	end_section();
+	write_section(document_term_offsets.data(), document_term_offsets.size() * sizeof(uint64_t));
+	for (size_t ordinal = 0; ordinal < ordinal_count; ++ordinal) {
+		const ForwardIndex::Terms document_terms = ordinal_to_terms_.Get(static_cast<int>(ordinal));
+		write(document_terms.begin(), document_terms.size() * sizeof(ForwardIndex::TermFreq));
+	}
+	end_section();
+	write_section(strings.data(), strings.size());
+	out.flush();
+	out.close();
+	if (!out) {
+		filesystem::remove(temp_path);
+		throw runtime_error("Cannot write index file "s + temp_path);
+	}
+	try {
+		SyncToDisk(temp_path);
+	}
+	catch (...) {
+		filesystem::remove(temp_path);
+		throw;
+	}
+	error_code error;
+	filesystem::rename(temp_path, path, error);
+	if (error) {
+		filesystem::remove(temp_path);
+		throw runtime_error("Cannot replace index file "s + path + ": "s + error.message());
+	}
+	const filesystem::path directory = filesystem::path(path).parent_path();
+	SyncToDisk(directory.empty() ? "."s : directory.string());
+}
+
+SearchServer SearchServer::Load(const std::string& path, std::pmr::memory_resource* resource)
+{
+	using namespace index_file;
+
+	auto file = make_shared<const MappedFile>(path);
+	Header header;
+	if (file->size() < sizeof(header)) {
+		throw runtime_error("Invalid index file "s + path);
+	}
+	memcpy(&header, file->data(), sizeof(header));
+	if (memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.byte_order_mark != BYTE_ORDER_MARK) {
+		throw runtime_error("Invalid index file "s + path);
+	}
+	if (header.version != VERSION) {
+		throw runtime_error("Unsupported index file version "s + to_string(header.version));
+	}
+
+	const auto check = [&path](bool condition) {
+		if (!condition) {
+			throw runtime_error("Corrupted index file "s + path);
+		}
+	};
+	const auto get_section = [&](const Section& section, size_t item_size) {
+		check(section.offset % 8 == 0 && section.offset <= file->size()
+			&& section.count <= (file->size() - section.offset) / item_size);
+		return file->data() + section.offset;
+	};
+	const char* strings = get_section(header.strings, sizeof(char));
+	const auto check_string = [&](const StringRef& ref) {
+		check(ref.offset <= header.strings.count && ref.size <= header.strings.count - ref.offset);
+	};
+	const auto get_string = [&](const StringRef& ref) {
+		check_string(ref);
+		return string_view(strings + ref.offset, ref.size);
+	};
+	const auto stop_word_refs = reinterpret_cast<const StringRef*>(get_section(header.stop_words, sizeof(StringRef)));
+	const auto ordinal_to_id = reinterpret_cast<const int32_t*>(get_section(header.ordinal_to_id, sizeof(int32_t)));
+	const auto ratings = reinterpret_cast<const int32_t*>(get_section(header.ratings, sizeof(int32_t)));
+	const auto statuses = reinterpret_cast<const int32_t*>(get_section(header.statuses, sizeof(int32_t)));
+	const auto text_refs = reinterpret_cast<const StringRef*>(get_section(header.text_refs, sizeof(StringRef)));
+	const auto document_ordinals = reinterpret_cast<const int32_t*>(get_section(header.document_ordinals, sizeof(int32_t)));
+	const auto term_freqs = reinterpret_cast<const double*>(get_section(header.term_freqs, sizeof(double)));
+	const auto terms = reinterpret_cast<const TermRecord*>(get_section(header.terms, sizeof(TermRecord)));
+	const auto posting_blocks = reinterpret_cast<const InvertedIndex::PostingList::Block*>(
+		get_section(header.posting_blocks, sizeof(InvertedIndex::PostingList::Block)));
+	const auto posting_data = reinterpret_cast<const uint8_t*>(get_section(header.posting_data, sizeof(uint8_t)));
+	const auto document_term_offsets = reinterpret_cast<const uint64_t*>(
+		get_section(header.document_term_offsets, sizeof(uint64_t)));
+	const auto document_terms = reinterpret_cast<const ForwardIndex::TermFreq*>(
+		get_section(header.document_terms, sizeof(ForwardIndex::TermFreq)));
+	const size_t ordinal_count = header.ordinal_to_id.count;
+	check(ordinal_count <= static_cast<size_t>(numeric_limits<int>::max())
+		&& header.ratings.count == ordinal_count && header.statuses.count == ordinal_count
+		&& header.text_refs.count == ordinal_count && header.document_term_offsets.count == ordinal_count + 1);
+
+	vector<string_view> stop_words;
+	for (size_t i = 0; i < header.stop_words.count; ++i) {
+		stop_words.push_back(get_string(stop_word_refs[i]));
+	}
+	SearchServer search_server(stop_words, resource);
+	search_server.mapped_file_ = file;
+
+	// столбцы документов копируются целиком, тексты остаются в файле
+	search_server.ordinal_to_id_.assign(ordinal_to_id, ordinal_to_id + ordinal_count);
+	search_server.ratings_.assign(ratings, ratings + ordinal_count);
+	search_server.statuses_.resize(ordinal_count);
+	search_server.text_refs_.resize(ordinal_count);
+	size_t removed_count = 0;
+	for (size_t ordinal = 0; ordinal < ordinal_count; ++ordinal) {
+		check(statuses[ordinal] >= 0 && static_cast<size_t>(statuses[ordinal]) < search_server.status_to_documents_.size());
+		check_string(text_refs[ordinal]);
+		search_server.statuses_[ordinal] = static_cast<DocumentStatus>(statuses[ordinal]);
+		search_server.text_refs_[ordinal] = { text_refs[ordinal].offset, text_refs[ordinal].size };
+		if (ordinal_to_id[ordinal] < 0) {
+			search_server.removed_documents_.Set(static_cast<int>(ordinal));
+			++removed_count;
+		}
+	}
+	search_server.text_store_ = DocumentTextStore(string_view(strings, header.strings.count));
+
+	// каждый живой номер встречается ровно один раз: id строго возрастают, а живых номеров столько же, сколько записей
+	check(header.document_ordinals.count + removed_count == ordinal_count);
+	search_server.id_to_ordinal_.reserve(header.document_ordinals.count);
+	for (size_t i = 0; i < header.document_ordinals.count; ++i) {
+		const int32_t ordinal = document_ordinals[i];
+		check(ordinal >= 0 && static_cast<size_t>(ordinal) < ordinal_count);
+		const int32_t document_id = ordinal_to_id[ordinal];
+		check(document_id >= 0 && (i == 0 || document_id > ordinal_to_id[document_ordinals[i - 1]]));
+		search_server.id_to_ordinal_.emplace(document_id, ordinal);
+		search_server.document_ids_.emplace_hint(search_server.document_ids_.end(), document_id);
+		search_server.status_to_documents_[statuses[ordinal]].Set(ordinal);
+	}
+
+	for (size_t freq_code = 0; freq_code < header.term_freqs.count; ++freq_code) {
+		// значения словаря частот различны, поэтому номера совпадают с сохранёнными
+		check(search_server.word_to_document_.AddTermFreq(term_freqs[freq_code]) == freq_code);
+	}
+
+	// списки не распаковываются: проверяются только таблицы блоков, сами блоки читаются из файла при поиске
+	search_server.word_to_document_.ReserveTerms(header.terms.count);
+	for (size_t term = 0; term < header.terms.count; ++term) {
+		const TermRecord& record = terms[term];
+		check(record.blocks_begin <= header.posting_blocks.count
+			&& record.block_count <= header.posting_blocks.count - record.blocks_begin
+			&& record.data_begin <= header.posting_data.count
+			&& record.data_size <= header.posting_data.count - record.data_begin
+			&& record.removed_count <= record.entry_count && (record.block_count == 0) == (record.entry_count == 0));
+		const InvertedIndex::PostingList::Block* blocks = posting_blocks + record.blocks_begin;
+		uint64_t entry_count = 0;
+		for (size_t block = 0; block < record.block_count; ++block) {
+			check(blocks[block].count > 0 && blocks[block].count <= InvertedIndex::PostingList::BLOCK_SIZE
+				&& blocks[block].offset < record.data_size && blocks[block].last_ordinal >= 0
+				&& static_cast<size_t>(blocks[block].last_ordinal) < ordinal_count
+				&& (block == 0 ? blocks[block].offset == 0 : (blocks[block].offset > blocks[block - 1].offset
+					&& blocks[block].last_ordinal > blocks[block - 1].last_ordinal)));
+			entry_count += blocks[block].count;
+		}
+		check(entry_count == record.entry_count && record.max_term_freq >= 0.0);
+		const InvertedIndex::TermId term_id = search_server.word_to_document_.AddMappedTerm(get_string(record.word),
+			InvertedIndex::PostingList(blocks, record.block_count, posting_data + record.data_begin, record.data_size,
+				record.entry_count, record.removed_count, resource),
+			record.max_term_freq);
+		// слово повторилось
+		check(term_id == term);
+	}
+
+	check(document_term_offsets[0] == 0 && document_term_offsets[ordinal_count] == header.document_terms.count);
+	for (size_t ordinal = 0; ordinal < ordinal_count; ++ordinal) {
+		check(document_term_offsets[ordinal] <= document_term_offsets[ordinal + 1]);
+	}
+	search_server.ordinal_to_terms_.Map(document_terms, document_term_offsets, ordinal_count);
+	return search_server;
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Формат файла индекса SearchServer::Save / SearchServer::Load.
+// Файл - заголовок и секции, выровненные на 8 байт, все числа в порядке байт машины, сохранившей файл.
+// Списки документов слов лежат в том же сжатом виде, что и в памяти (таблица блоков и varint-данные),
+// прямой индекс и столбцы документов - массивами по порядковому номеру. Load не распаковывает и не копирует
+// их: сервер читает их прямо из отображённого файла, страницы подгружаются при первом обращении.
+// Строки (стоп-слова, слова словаря, тексты документов) лежат в общем блоке и адресуются StringRef.
+namespace index_file {
+
+const char MAGIC[8] = { 'S', 'R', 'C', 'H', 'I', 'D', 'X', '\0' };
+const uint32_t VERSION = 2;
+const uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+struct StringRef {
+	uint64_t offset; // от начала блока строк
+	uint64_t size;
+};
+
+struct Section {
+	uint64_t offset; // от начала файла
+	uint64_t count;  // число элементов
+};
+
+struct Header {
+	char magic[8];
+	uint32_t version;
+	uint32_t byte_order_mark;
+	Section stop_words;            // StringRef
+	Section ordinal_to_id;         // int32_t по порядковому номеру, -1 для удалённых документов
+	Section ratings;               // int32_t по порядковому номеру
+	Section statuses;              // int32_t по порядковому номеру
+	Section text_refs;             // StringRef по порядковому номеру
+	Section document_ordinals;     // int32_t, порядковые номера документов по возрастанию id
+	Section term_freqs;            // double, словарь частот: значение по номеру частоты
+	Section terms;                 // TermRecord по номеру слова
+	Section posting_blocks;        // InvertedIndex::PostingList::Block, таблицы блоков всех слов подряд
+	Section posting_data;          // uint8_t, сжатые блоки всех слов подряд
+	Section document_term_offsets; // uint64_t, границы слов документов в document_terms, на одну больше номеров
+	Section document_terms;        // ForwardIndex::TermFreq, слова документов подряд по порядковому номеру
+	Section strings;               // char
+};
+
+struct TermRecord {
+	StringRef word;
+	uint64_t blocks_begin;  // индекс в posting_blocks
+	uint64_t block_count;
+	uint64_t data_begin;    // смещение в posting_data
+	uint64_t data_size;
+	uint64_t entry_count;   // записей в блоках, вместе с удалёнными пометкой
+	uint64_t removed_count; // записей удалённых пометкой документов
+	double max_term_freq;
+};
+
+static_assert(sizeof(Header) == 224, "index file header layout changed");
+static_assert(sizeof(TermRecord) == 72, "index file term layout changed");
+
+// файл, отображённый в память только для чтения; без mmap читается целиком
+class MappedFile {
+public:
+	explicit MappedFile(const std::string& path);
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	const char* data() const {
+		return data_;
+	}
+
+	size_t size() const {
+		return size_;
+	}
+
+private:
+	const char* data_ = nullptr;
+	size_t size_ = 0;
+	std::vector<char> buffer_;
+	bool mapped_ = false;
+};
+
+} // namespace index_file
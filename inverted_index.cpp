@@ -0,0 +1,256 @@
+#include "inverted_index.h"
+
+#include <cmath>
+#include <cstddef>
+
+namespace {
+
+void WriteVarint(std::pmr::vector<uint8_t>& out, uint32_t value)
+{
+	while (value >= 0x80) {
+		out.push_back(static_cast<uint8_t>(value | 0x80));
+		value >>= 7;
+	}
+	out.push_back(static_cast<uint8_t>(value));
+}
+
+uint32_t ReadVarint(const uint8_t*& in)
+{
+	uint32_t value = 0;
+	for (int shift = 0;; shift += 7) {
+		const uint8_t byte = *in++;
+		value |= static_cast<uint32_t>(byte & 0x7f) << shift;
+		if (byte < 0x80) {
+			return value;
+		}
+	}
+}
+
+// первый номер блока целиком, остальные - разностью с предыдущим
+void EncodeBlock(std::pmr::vector<uint8_t>& out, const int* ordinals, const InvertedIndex::FreqCode* freq_codes, size_t count)
+{
+	for (size_t i = 0; i < count; ++i) {
+		WriteVarint(out, static_cast<uint32_t>(i == 0 ? ordinals[i] : ordinals[i] - ordinals[i - 1]));
+		WriteVarint(out, freq_codes[i]);
+	}
+}
+
+} // namespace
+
+void InvertedIndex::PostingList::Unmap()
+{
+	if (!is_mapped_) {
+		return;
+	}
+	blocks_.assign(mapped_blocks_, mapped_blocks_ + mapped_block_count_);
+	data_.assign(mapped_data_, mapped_data_ + mapped_data_size_);
+	mapped_blocks_ = nullptr;
+	mapped_block_count_ = 0;
+	mapped_data_ = nullptr;
+	mapped_data_size_ = 0;
+	is_mapped_ = false;
+}
+
+void InvertedIndex::PostingList::Insert(int ordinal, FreqCode freq_code)
+{
+	Unmap();
+	if (blocks_.empty() || blocks_.back().last_ordinal < ordinal) {
+		if (blocks_.empty() || blocks_.back().count == BLOCK_SIZE) {
+			blocks_.push_back({ ordinal, 1, data_.size() });
+			WriteVarint(data_, static_cast<uint32_t>(ordinal));
+		}
+		else {
+			Block& block = blocks_.back();
+			WriteVarint(data_, static_cast<uint32_t>(ordinal - block.last_ordinal));
+			block.last_ordinal = ordinal;
+			++block.count;
+		}
+		WriteVarint(data_, freq_code);
+		++size_;
+		return;
+	}
+	const size_t block = FindBlock(0, ordinal);
+	int ordinals[BLOCK_SIZE + 1];
+	FreqCode freq_codes[BLOCK_SIZE + 1];
+	DecodeBlock(block, ordinals, freq_codes);
+	const size_t count = blocks_[block].count;
+	const size_t pos = std::lower_bound(ordinals, ordinals + count, ordinal) - ordinals;
+	if (ordinals[pos] == ordinal) {
+		freq_codes[pos] = freq_code;
+		ReplaceBlock(block, ordinals, freq_codes, count);
+		return;
+	}
+	std::copy_backward(ordinals + pos, ordinals + count, ordinals + count + 1);
+	std::copy_backward(freq_codes + pos, freq_codes + count, freq_codes + count + 1);
+	ordinals[pos] = ordinal;
+	freq_codes[pos] = freq_code;
+	++size_;
+	ReplaceBlock(block, ordinals, freq_codes, count + 1);
+}
+
+double InvertedIndex::PostingList::GetInverseDocumentFreq(int document_count) const
+{
+	const uint64_t version = (static_cast<uint64_t>(document_count) << 32) | static_cast<uint32_t>(size());
+	if (inverse_document_freq_.version.load(std::memory_order_acquire) == version) {
+		return inverse_document_freq_.value.load(std::memory_order_relaxed);
+	}
+	const double value = std::log(document_count * 1.0 / size());
+	inverse_document_freq_.value.store(value, std::memory_order_relaxed);
+	inverse_document_freq_.version.store(version, std::memory_order_release);
+	return value;
+}
+
+bool InvertedIndex::PostingList::Contains(int ordinal) const
+{
+	const size_t block = FindBlock(0, ordinal);
+	if (block == GetBlockCount()) {
+		return false;
+	}
+	int ordinals[BLOCK_SIZE];
+	FreqCode freq_codes[BLOCK_SIZE];
+	DecodeBlock(block, ordinals, freq_codes);
+	return std::binary_search(ordinals, ordinals + GetBlocks()[block].count, ordinal);
+}
+
+void InvertedIndex::PostingList::Erase(int ordinal)
+{
+	Unmap();
+	const size_t block = FindBlock(0, ordinal);
+	if (block == blocks_.size()) {
+		return;
+	}
+	int ordinals[BLOCK_SIZE];
+	FreqCode freq_codes[BLOCK_SIZE];
+	DecodeBlock(block, ordinals, freq_codes);
+	const size_t count = blocks_[block].count;
+	const size_t pos = std::lower_bound(ordinals, ordinals + count, ordinal) - ordinals;
+	if (ordinals[pos] != ordinal) {
+		return;
+	}
+	std::copy(ordinals + pos + 1, ordinals + count, ordinals + pos);
+	std::copy(freq_codes + pos + 1, freq_codes + count, freq_codes + pos);
+	--size_;
+	ReplaceBlock(block, ordinals, freq_codes, count - 1);
+}
+
+size_t InvertedIndex::PostingList::FindBlock(size_t first_block, int ordinal) const
+{
+	const Block* blocks = GetBlocks();
+	return std::partition_point(blocks + first_block, blocks + GetBlockCount(),
+		[ordinal](const Block& block) { return block.last_ordinal < ordinal; }) - blocks;
+}
+
+void InvertedIndex::PostingList::DecodeBlock(size_t block, int* ordinals, FreqCode* freq_codes) const
+{
+	const Block& entry = GetBlocks()[block];
+	const uint8_t* in = GetData() + entry.offset;
+	int ordinal = 0;
+	for (uint32_t i = 0; i < entry.count; ++i) {
+		ordinal += static_cast<int>(ReadVarint(in));
+		ordinals[i] = ordinal;
+		freq_codes[i] = ReadVarint(in);
+	}
+}
+
+void InvertedIndex::PostingList::ReplaceBlock(size_t block, const int* ordinals, const FreqCode* freq_codes, size_t count)
+{
+	std::pmr::vector<uint8_t> encoded(data_.get_allocator());
+	std::pmr::vector<Block> new_blocks(blocks_.get_allocator());
+	const size_t offset = blocks_[block].offset;
+	// переполненный блок делится пополам
+	const size_t part_count = count > BLOCK_SIZE ? 2 : (count > 0 ? 1 : 0);
+	for (size_t part = 0; part < part_count; ++part) {
+		const size_t begin = count * part / part_count;
+		const size_t end = count * (part + 1) / part_count;
+		new_blocks.push_back({ ordinals[end - 1], static_cast<uint32_t>(end - begin), offset + encoded.size() });
+		EncodeBlock(encoded, ordinals + begin, freq_codes + begin, end - begin);
+	}
+
+	const size_t old_end = GetBlockEnd(block);
+	const auto shift = static_cast<std::ptrdiff_t>(encoded.size()) - static_cast<std::ptrdiff_t>(old_end - offset);
+	data_.erase(data_.begin() + offset, data_.begin() + old_end);
+	data_.insert(data_.begin() + offset, encoded.begin(), encoded.end());
+	for (size_t i = block + 1; i < blocks_.size(); ++i) {
+		blocks_[i].offset += shift;
+	}
+	blocks_.erase(blocks_.begin() + block);
+	blocks_.insert(blocks_.begin() + block, new_blocks.begin(), new_blocks.end());
+}
+
+void InvertedIndex::PostingList::Cursor::LoadBlock(size_t block)
+{
+	block_ = block;
+	pos_ = 0;
+	count_ = 0;
+	if (block < block_count_) {
+		count_ = blocks_[block].count;
+		postings_->DecodeBlock(block, ordinals_, freq_codes_);
+	}
+}
+
+void InvertedIndex::PostingList::Cursor::SkipTo(int ordinal)
+{
+	if (AtEnd()) {
+		return;
+	}
+	if (blocks_[block_].last_ordinal < ordinal) {
+		LoadBlock(postings_->FindBlock(block_ + 1, ordinal));
+		if (AtEnd()) {
+			return;
+		}
+	}
+	pos_ = std::lower_bound(ordinals_ + pos_, ordinals_ + count_, ordinal) - ordinals_;
+}
+
+InvertedIndex::InvertedIndex(std::pmr::memory_resource* resource)
+	: term_arena_(std::make_unique<std::pmr::monotonic_buffer_resource>(resource))
+	, terms_(resource)
+	, term_to_id_(resource)
+	, freq_values_(resource)
+	, freq_to_code_(resource) {
+}
+
+InvertedIndex::TermId InvertedIndex::FindTermId(std::string_view word) const
+{
+	const auto it = term_to_id_.find(word);
+	return it != term_to_id_.end() ? it->second : NO_TERM;
+}
+
+InvertedIndex::TermId InvertedIndex::AddTerm(std::string_view word)
+{
+	const auto it = term_to_id_.find(word);
+	if (it != term_to_id_.end()) {
+		return it->second;
+	}
+	const TermId term_id = static_cast<TermId>(terms_.size());
+	char* chars = static_cast<char*>(term_arena_->allocate(word.size(), alignof(char)));
+	std::copy(word.begin(), word.end(), chars);
+	terms_.push_back({ std::string_view(chars, word.size()), PostingList(terms_.get_allocator().resource()), 0.0 });
+	term_to_id_.emplace(terms_.back().word, term_id);
+	return term_id;
+}
+
+InvertedIndex::TermId InvertedIndex::AddMappedTerm(std::string_view word, PostingList postings, double max_term_freq)
+{
+	const TermId term_id = static_cast<TermId>(terms_.size());
+	if (!term_to_id_.emplace(word, term_id).second) {
+		return NO_TERM;
+	}
+	terms_.push_back({ word, std::move(postings), max_term_freq });
+	return term_id;
+}
+
+InvertedIndex::FreqCode InvertedIndex::AddTermFreq(double term_freq)
+{
+	const auto[it, inserted] = freq_to_code_.emplace(term_freq, static_cast<FreqCode>(freq_values_.size()));
+	if (inserted) {
+		freq_values_.push_back(term_freq);
+	}
+	return it->second;
+}
+
+const InvertedIndex::PostingList* InvertedIndex::Find(std::string_view word) const
+{
+	const TermId term_id = FindTermId(word);
+	return term_id != NO_TERM ? &terms_[term_id].postings : nullptr;
+}
@@ -0,0 +1,332 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <algorithm>
+#include <utility>
+#include <atomic>
+#include <limits>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <execution>
+
+// Обратный индекс: слово -> сжатый отсортированный список (порядковый номер документа, частота слова).
+// Слова получают плотные целые номера (TermId), списки хранятся как структура массивов по номеру слова,
+// строка ищется в хеш-таблице только один раз на границе API.
+// Строки слов принадлежат индексу, поэтому string_view на них не зависят от текстов документов.
+// Вся память индекса берётся из переданного memory_resource, он должен пережить индекс. Строки слов
+// складываются в собственную арену индекса и освобождаются разом. Для пакетного добавления ресурс должен быть потокобезопасным.
+class InvertedIndex {
+public:
+	explicit InvertedIndex(std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+	// копия ссылалась бы на строки оригинала
+	InvertedIndex(const InvertedIndex&) = delete;
+	InvertedIndex& operator=(const InvertedIndex&) = delete;
+	InvertedIndex(InvertedIndex&&) = default;
+	InvertedIndex& operator=(InvertedIndex&&) = default;
+
+	// номер значения частоты в словаре частот индекса. Частот немного (это доли k / длина документа),
+	// поэтому в списках хранится номер, а не само значение - без потери точности
+	using FreqCode = uint32_t;
+
+	// Сжатый список документов слова: блоки до BLOCK_SIZE записей (порядковый номер, номер частоты).
+	// Внутри блока номера документов хранятся разностями в varint, первый - целиком, поэтому блоки
+	// независимы. Для каждого блока запоминается последний номер - по нему Cursor::SkipTo пропускает блоки не распаковывая.
+	class PostingList {
+	public:
+		static constexpr size_t BLOCK_SIZE = 128;
+
+		// запись таблицы блоков; раскладка совпадает с файлом индекса
+		struct Block {
+			int32_t last_ordinal; // номер последнего документа блока
+			uint32_t count;
+			uint64_t offset;      // начало блока в данных списка
+		};
+
+		explicit PostingList(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+			: blocks_(resource)
+			, data_(resource) {
+		}
+
+		// список, который читает таблицу блоков и сжатые данные из чужой памяти (отображённого файла индекса)
+		// без копирования. Память должна жить дольше списка; при первом изменении список копирует её к себе.
+		// entry_count - записей в блоках вместе с удалёнными пометкой, removed_count - удалённых пометкой
+		PostingList(const Block* blocks, size_t block_count, const uint8_t* data, size_t data_size,
+			size_t entry_count, size_t removed_count, std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+			: blocks_(resource)
+			, data_(resource)
+			, mapped_blocks_(blocks)
+			, mapped_block_count_(block_count)
+			, mapped_data_(data)
+			, mapped_data_size_(data_size)
+			, is_mapped_(true)
+			, size_(entry_count)
+			, removed_count_(removed_count) {
+		}
+
+		class Cursor;
+
+		// idf = log(document_count / size()), пересчитывается только при изменении числа документов или длины списка
+		double GetInverseDocumentFreq(int document_count) const;
+
+		// число документов без удалённых пометкой MarkRemoved
+		size_t size() const {
+			return size_ - removed_count_;
+		}
+
+		bool empty() const {
+			return size() == 0;
+		}
+
+		// распаковывает только блок, в который может попасть документ
+		bool Contains(int ordinal) const;
+
+		// порядковые номера выдаются по возрастанию - обычно запись дописывается в последний блок.
+		// если документ уже есть в списке, заменяется номер частоты
+		void Insert(int ordinal, FreqCode freq_code);
+
+		void Erase(int ordinal);
+
+		// удаление пометкой: запись остаётся в списке и видна курсору, пока список не перестроят,
+		// но документ больше не учитывается в size(). Проверять, удалён ли документ, должен читатель
+		void MarkRemoved() {
+			++removed_count_;
+		}
+
+		// байт занято сжатыми данными и таблицей блоков
+		size_t GetByteSize() const {
+			return GetDataSize() + GetBlockCount() * sizeof(Block);
+		}
+
+		// таблица блоков и сжатые данные - в памяти списка или в отображённом файле
+		const Block* GetBlocks() const {
+			return is_mapped_ ? mapped_blocks_ : blocks_.data();
+		}
+
+		size_t GetBlockCount() const {
+			return is_mapped_ ? mapped_block_count_ : blocks_.size();
+		}
+
+		const uint8_t* GetData() const {
+			return is_mapped_ ? mapped_data_ : data_.data();
+		}
+
+		size_t GetDataSize() const {
+			return is_mapped_ ? mapped_data_size_ : data_.size();
+		}
+
+		// записей в блоках вместе с удалёнными пометкой
+		size_t GetEntryCount() const {
+			return size_;
+		}
+
+		size_t GetRemovedCount() const {
+			return removed_count_;
+		}
+
+	private:
+		std::pmr::vector<Block> blocks_;
+		std::pmr::vector<uint8_t> data_;
+		// чужая память, пока список её не скопировал
+		const Block* mapped_blocks_ = nullptr;
+		size_t mapped_block_count_ = 0;
+		const uint8_t* mapped_data_ = nullptr;
+		size_t mapped_data_size_ = 0;
+		bool is_mapped_ = false;
+		size_t size_ = 0;
+		size_t removed_count_ = 0;
+
+		// копирует чужую память к себе перед изменением списка
+		void Unmap();
+
+		// первый блок, который может содержать ordinal; blocks_.size(), если таких нет
+		size_t FindBlock(size_t first_block, int ordinal) const;
+
+		size_t GetBlockEnd(size_t block) const {
+			return block + 1 < GetBlockCount() ? GetBlocks()[block + 1].offset : GetDataSize();
+		}
+
+		void DecodeBlock(size_t block, int* ordinals, FreqCode* freq_codes) const;
+
+		// заменяет блок записями [0, count), при переполнении делит его на два, пустой удаляет
+		void ReplaceBlock(size_t block, const int* ordinals, const FreqCode* freq_codes, size_t count);
+
+		// запомненный idf и "версия" (число документов, длина списка), для которой он посчитан.
+		// во время поиска индекс не меняется, поэтому все читатели записывают одно и то же значение
+		struct CachedInverseDocumentFreq {
+			mutable std::atomic<uint64_t> version{ std::numeric_limits<uint64_t>::max() };
+			mutable std::atomic<double> value{ 0.0 };
+
+			CachedInverseDocumentFreq() = default;
+			CachedInverseDocumentFreq(const CachedInverseDocumentFreq&) {
+			}
+			CachedInverseDocumentFreq& operator=(const CachedInverseDocumentFreq&) {
+				version = std::numeric_limits<uint64_t>::max();
+				return *this;
+			}
+		};
+		CachedInverseDocumentFreq inverse_document_freq_;
+	};
+
+	// плотный номер слова, выдаётся при первом появлении слова в документе
+	using TermId = uint32_t;
+	static constexpr TermId NO_TERM = std::numeric_limits<TermId>::max();
+
+	// NO_TERM, если слово не встречалось в документах
+	TermId FindTermId(std::string_view word) const;
+
+	// находит или заводит слово
+	TermId AddTerm(std::string_view word);
+
+	// заводит слово со списком из отображённого файла индекса; строка слова не копируется и должна жить дольше индекса.
+	// NO_TERM, если слово уже есть
+	TermId AddMappedTerm(std::string_view word, PostingList postings, double max_term_freq);
+
+	void ReserveTerms(size_t term_count) {
+		term_to_id_.reserve(term_count);
+	}
+
+	// строка слова внутри индекса
+	std::string_view GetTerm(TermId term_id) const {
+		return terms_[term_id].word;
+	}
+
+	const PostingList& GetPostings(TermId term_id) const {
+		return terms_[term_id].postings;
+	}
+
+	// списки разных слов можно дополнять из разных потоков, если словарь частот при этом не меняется
+	void AddPosting(TermId term_id, int ordinal, FreqCode freq_code) {
+		Term& term = terms_[term_id];
+		term.postings.Insert(ordinal, freq_code);
+		term.max_term_freq = std::max(term.max_term_freq, freq_values_[freq_code]);
+	}
+
+	// один из документов списка удалён пометкой, его запись пропадёт из списка при RemapOrdinals.
+	// списки разных слов можно помечать из разных потоков
+	void MarkRemoved(TermId term_id) {
+		terms_[term_id].postings.MarkRemoved();
+	}
+
+	// переносит записи списков на новые порядковые номера: new_ordinals[старый номер], -1 - запись удаляется.
+	// новые номера должны возрастать вместе со старыми. Списки перестраиваются независимо, по одному на поток,
+	// оценки частот слов пересчитываются по оставшимся записям
+	template <typename Execution>
+	void RemapOrdinals(Execution&& policy, const std::vector<int>& new_ordinals);
+
+	// оценка сверху частоты слова в любом документе списка; после удалений до RemapOrdinals может быть больше точной
+	double GetMaxTermFreq(TermId term_id) const {
+		return terms_[term_id].max_term_freq;
+	}
+
+	// возвращает nullptr, если слово не встречалось в документах
+	const PostingList* Find(std::string_view word) const;
+
+	size_t GetTermCount() const {
+		return terms_.size();
+	}
+
+	// находит или заводит номер частоты
+	FreqCode AddTermFreq(double term_freq);
+
+	// номер уже заведённой частоты; можно вызывать из нескольких потоков, пока словарь частот не меняется
+	FreqCode FindTermFreq(double term_freq) const {
+		return freq_to_code_.at(term_freq);
+	}
+
+	double GetTermFreq(FreqCode freq_code) const {
+		return freq_values_[freq_code];
+	}
+
+	size_t GetTermFreqCount() const {
+		return freq_values_.size();
+	}
+
+	// вызывает action(номер слова, слово, список) для каждого слова в порядке номеров
+	template <typename Action>
+	void ForEachTerm(Action action) const {
+		for (TermId term_id = 0; term_id < terms_.size(); ++term_id) {
+			action(term_id, terms_[term_id].word, terms_[term_id].postings);
+		}
+	}
+
+private:
+	struct Term {
+		std::string_view word; // в term_arena_
+		PostingList postings;
+		double max_term_freq = 0.0;
+	};
+	// арена в куче: при перемещении индекса строки слов остаются на месте
+	std::unique_ptr<std::pmr::monotonic_buffer_resource> term_arena_;
+	std::pmr::deque<Term> terms_; // индекс - номер слова; deque не перемещает элементы при добавлении
+	std::pmr::unordered_map<std::string_view, TermId> term_to_id_;
+	std::pmr::vector<double> freq_values_; // индекс - номер частоты
+	std::pmr::unordered_map<double, FreqCode> freq_to_code_;
+};
+
+// Последовательное чтение списка по возрастанию номеров документов, блок распаковывается целиком.
+// Список не должен меняться, пока курсор используется.
+class InvertedIndex::PostingList::Cursor {
+public:
+	explicit Cursor(const PostingList& postings)
+		: postings_(&postings)
+		, blocks_(postings.GetBlocks())
+		, block_count_(postings.GetBlockCount()) {
+		LoadBlock(0);
+	}
+
+	bool AtEnd() const {
+		return block_ == block_count_;
+	}
+
+	int GetOrdinal() const {
+		return ordinals_[pos_];
+	}
+
+	FreqCode GetFreqCode() const {
+		return freq_codes_[pos_];
+	}
+
+	void Next() {
+		if (++pos_ == count_) {
+			LoadBlock(block_ + 1);
+		}
+	}
+
+	// переходит к первому документу с порядковым номером не меньше ordinal, блоки с меньшими номерами не распаковываются
+	void SkipTo(int ordinal);
+
+private:
+	const PostingList* postings_;
+	const Block* blocks_;
+	size_t block_count_;
+	size_t block_ = 0;
+	size_t pos_ = 0;
+	size_t count_ = 0;
+	int ordinals_[BLOCK_SIZE];
+	FreqCode freq_codes_[BLOCK_SIZE];
+
+	void LoadBlock(size_t block);
+};
+
+template <typename Execution>
+void InvertedIndex::RemapOrdinals(Execution&& policy, const std::vector<int>& new_ordinals)
+{
+	std::pmr::memory_resource* const resource = terms_.get_allocator().resource();
+	std::for_each(policy, terms_.begin(), terms_.end(), [&](Term& term) {
+		PostingList postings(resource);
+		double max_term_freq = 0.0;
+		for (PostingList::Cursor cursor(term.postings); !cursor.AtEnd(); cursor.Next()) {
+			const int ordinal = new_ordinals[cursor.GetOrdinal()];
+			if (ordinal >= 0) {
+				postings.Insert(ordinal, cursor.GetFreqCode());
+				max_term_freq = std::max(max_term_freq, freq_values_[cursor.GetFreqCode()]);
+			}
+		}
+		term.postings = std::move(postings);
+		term.max_term_freq = max_term_freq;
+	});
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+#define PROFILE_CONCAT_INTERNAL(X, Y) X##Y
+#define PROFILE_CONCAT(X, Y) PROFILE_CONCAT_INTERNAL(X, Y)
+#define UNIQUE_VAR_NAME_PROFILE PROFILE_CONCAT(profileGuard, __LINE__)
+#define LOG_DURATION(x) LogDuration UNIQUE_VAR_NAME_PROFILE(x)
+#define LOG_DURATION_STREAM(x, y) LogDuration UNIQUE_VAR_NAME_PROFILE(x, y)
+
+// замеряет время жизни объекта и при разрушении печатает "id: N ms" в поток out
+class LogDuration {
+public:
+	using Clock = std::chrono::steady_clock;
+
+	explicit LogDuration(std::string_view id, std::ostream& out = std::cerr)
+		: id_(id)
+		, out_(out) {
+	}
+
+	~LogDuration() {
+		using namespace std::chrono;
+		const auto dur = Clock::now() - start_time_;
+		out_ << id_ << ": " << duration_cast<milliseconds>(dur).count() << " ms" << std::endl;
+	}
+
+private:
+	const std::string id_;
+	std::ostream& out_;
+	const Clock::time_point start_time_ = Clock::now();
+};
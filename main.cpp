@@ -1,51 +1,19 @@
 #include "search_server.h"
+#include "corpus_generator.h"
 #include "log_duration.h"
 #include "process_queries.h"
 #include <execution>
+#include <fstream>
 #include <iostream>
+#include <memory_resource>
+#include <optional>
 #include <random>
 #include <string>
 #include <vector>
+#ifdef __linux__
+#include <unistd.h>
+#endif
 using namespace std;
-string GenerateWord(mt19937& generator, int max_length) {
-    const int length = uniform_int_distribution(1, max_length)(generator);
-    string word;
-    word.reserve(length);
-    for (int i = 0; i < length; ++i) {
-        word.push_back(uniform_int_distribution('a', 'z')(generator));
-    }
-    return word;
-}
-vector<string> GenerateDictionary(mt19937& generator, int word_count, int max_length) {
-    vector<string> words;
-    words.reserve(word_count);
-    for (int i = 0; i < word_count; ++i) {
-        words.push_back(GenerateWord(generator, max_length));
-    }
-    words.erase(unique(words.begin(), words.end()), words.end());
-    return words;
-}
-string GenerateQuery(mt19937& generator, const vector<string>& dictionary, int word_count, double minus_prob = 0) {
-    string query;
-    for (int i = 0; i < word_count; ++i) {
-        if (!query.empty()) {
-            query.push_back(' ');
-        }
-        if (uniform_real_distribution<>(0, 1)(generator) < minus_prob) {
-            query.push_back('-');
-        }
-        query += dictionary[uniform_int_distribution<int>(0, dictionary.size() - 1)(generator)];
-    }
-    return query;
-}
-vector<string> GenerateQueries(mt19937& generator, const vector<string>& dictionary, int query_count, int max_word_count) {
-    vector<string> queries;
-    queries.reserve(query_count);
-    for (int i = 0; i < query_count; ++i) {
-        queries.push_back(GenerateQuery(generator, dictionary, max_word_count));
-    }
-    return queries;
-}
 template <typename ExecutionPolicy>
 void Test(string_view mark, const SearchServer& search_server, const vector<string>& queries, ExecutionPolicy&& policy) {
     LOG_DURATION(mark);
@@ -58,10 +26,61 @@ void Test(string_view mark, const SearchServer& search_server, const vector<stri
     cout << total_relevance << endl;
 }
 #define TEST(policy) Test(#policy, search_server, queries, execution::policy)
-int main() {
+// резидентная память процесса в КБ, nullopt вне Linux
+optional<size_t> GetResidentKb() {
+#ifdef __linux__
+    ifstream statm("/proc/self/statm");
+    size_t total_pages = 0, resident_pages = 0;
+    const long page_size = sysconf(_SC_PAGESIZE);
+    if (!(statm >> total_pages >> resident_pages) || page_size <= 0) {
+        return nullopt;
+    }
+    return resident_pages * (static_cast<size_t>(page_size) / 1024);
+#else
+    return nullopt;
+#endif
+}
+// время наполнения и разрушения индекса и прирост RSS при размещении индекса в resource
+void TestIngest(string_view mark, const vector<string>& documents, pmr::memory_resource* resource) {
+    const optional<size_t> resident_before = GetResidentKb();
+    optional<SearchServer> search_server;
+    {
+        LOG_DURATION(string(mark) + " ingest");
+        search_server.emplace("and with"s, resource);
+        for (size_t i = 0; i < documents.size(); ++i) {
+            search_server->AddDocument(i, documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
+        }
+    }
+    const optional<size_t> resident_after = GetResidentKb();
+    if (resident_before && resident_after) {
+        // RSS может и уменьшиться, если аллокатор вернул системе память
+        cout << mark << " RSS " << showpos << static_cast<long long>(*resident_after) - static_cast<long long>(*resident_before)
+             << noshowpos << " KB" << endl;
+    } else {
+        cout << mark << " RSS n/a" << endl;
+    }
+    LOG_DURATION(string(mark) + " teardown");
+    search_server.reset();
+}
+// без аргументов - сравнение поиска seq и par; "ingest default|pool|monotonic" - наполнение индекса
+// в заданном ресурсе памяти, каждый ресурс запускается отдельным процессом, чтобы RSS не искажался предыдущим
+int main(int argc, char* argv[]) {
     mt19937 generator;
     const auto dictionary = GenerateDictionary(generator, 1000, 10);
     const auto documents = GenerateQueries(generator, dictionary, 10'000, 70);
+    if (argc == 3 && argv[1] == "ingest"s) {
+        const string resource_name = argv[2];
+        if (resource_name == "monotonic"s) {
+            pmr::monotonic_buffer_resource arena;
+            TestIngest(resource_name, documents, &arena);
+        } else if (resource_name == "pool"s) {
+            pmr::unsynchronized_pool_resource pool;
+            TestIngest(resource_name, documents, &pool);
+        } else {
+            TestIngest(resource_name, documents, pmr::get_default_resource());
+        }
+        return 0;
+    }
     SearchServer search_server(dictionary[0]);
     for (size_t i = 0; i < documents.size(); ++i) {
         search_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
@@ -69,4 +88,4 @@ int main() {
     const auto queries = GenerateQueries(generator, dictionary, 100, 70);
     TEST(seq);
     TEST(par);
-} 
+}
\ No newline at end of file
@@ -18,7 +18,7 @@ public:
 		return end_;
 	}
 	size_t size() const {
-		return  distance(begin_, end_);
+		return  std::distance(begin_, end_);
 	}
 private:
 	Iterator begin_;
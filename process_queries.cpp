@@ -1,33 +1,40 @@
 #include "process_queries.h"
+#include "batch_query_executor.h"
 
+#include <algorithm>
 #include <numeric>
 #include <execution>
-#include <numeric>
+
+namespace {
+
+// пул создаётся при первом вызове и живёт до конца программы
+BatchQueryExecutor& GetQueryExecutor()
+{
+	static BatchQueryExecutor executor;
+	return executor;
+}
+
+} // namespace
 
 std::vector<std::vector<Document>> ProcessQueries(
 	const SearchServer& search_server,
 	const std::vector<std::string>& queries) {
 
 	std::vector<std::vector<Document>> result(queries.size());
-	std::transform(std::execution::par,
-		queries.begin(), queries.end(),
-	    result.begin(),
-		[&](auto &query) {
-		return search_server.FindTopDocuments(query);
+	GetQueryExecutor().Process(search_server, queries, [&result](size_t query_index, std::vector<Document> documents) {
+		result[query_index] = std::move(documents);
 	});
 	return result;
 }
 
-std::vector<Document> ProcessQueriesJoined(
+JoinedDocuments ProcessQueriesJoined(
 	const SearchServer& search_server,
 	const std::vector<std::string>& queries)
 {
-	std::vector<Document> result;
-	int pos = 0;
-	for (auto & vec_doc : ProcessQueries(search_server, queries))
-	{
-		result.insert(result.begin() + pos, vec_doc.begin(), vec_doc.end());
-		pos += vec_doc.size();
-	}
+	JoinedDocuments result(queries.size());
+	// запрос i пишет лучшие документы прямо в свои ячейки, а их число - в offsets_[i + 1]
+	GetQueryExecutor().ProcessInto(search_server, queries, result.documents_.data(), MAX_RESULT_DOCUMENT_COUNT,
+		result.offsets_.data() + 1);
+	std::partial_sum(result.offsets_.begin(), result.offsets_.end(), result.offsets_.begin());
 	return result;
 }
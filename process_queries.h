@@ -1,12 +1,127 @@
 #pragma once
+#include <cstddef>
+#include <iterator>
+#include <vector>
+
 #include "search_server.h"
+#include "paginator.h"
 
+//выполняет запросы в общем пуле BatchQueryExecutor, результаты - в порядке запросов
 std::vector<std::vector<Document>> ProcessQueries(
 	const SearchServer& search_server,
 	const std::vector<std::string>& queries);
 
+// Результаты пакета запросов в одном буфере, выделенном заранее: запрос i пишет свои документы
+// в ячейки с i * MAX_RESULT_DOCUMENT_COUNT, число документов запроса - разность соседних префиксных сумм.
+// Обход выдаёт документы всех запросов подряд, перепрыгивая незанятые ячейки, без копирования в отдельный вектор.
+class JoinedDocuments {
+public:
+	class Iterator {
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = Document;
+		using difference_type = std::ptrdiff_t;
+		using pointer = const Document*;
+		using reference = const Document&;
+
+		reference operator*() const {
+			return *current_;
+		}
+
+		pointer operator->() const {
+			return current_;
+		}
+
+		Iterator& operator++() {
+			++current_;
+			SkipQueryEnds();
+			return *this;
+		}
+
+		Iterator operator++(int) {
+			Iterator previous = *this;
+			++*this;
+			return previous;
+		}
+
+		bool operator==(const Iterator& other) const {
+			return current_ == other.current_;
+		}
+
+		bool operator!=(const Iterator& other) const {
+			return current_ != other.current_;
+		}
+
+	private:
+		friend class JoinedDocuments;
+
+		Iterator(const JoinedDocuments& documents, size_t query_index)
+			: documents_(&documents)
+			, query_index_(query_index)
+			, current_(documents.GetQueryBegin(query_index)) {
+			SkipQueryEnds();
+		}
+
+		// с конца документов запроса - на первый документ следующего непустого запроса
+		void SkipQueryEnds() {
+			while (query_index_ < documents_->GetQueryCount() && current_ == documents_->GetQueryEnd(query_index_)) {
+				current_ = documents_->GetQueryBegin(++query_index_);
+			}
+		}
+
+		const JoinedDocuments* documents_;
+		size_t query_index_;
+		const Document* current_;
+	};
+
+	explicit JoinedDocuments(size_t query_count)
+		: documents_(query_count * MAX_RESULT_DOCUMENT_COUNT)
+		, offsets_(query_count + 1, 0) {
+	}
+
+	Iterator begin() const {
+		return Iterator(*this, 0);
+	}
+
+	Iterator end() const {
+		return Iterator(*this, GetQueryCount());
+	}
+
+	// всего документов
+	size_t size() const {
+		return offsets_.back();
+	}
+
+	bool empty() const {
+		return size() == 0;
+	}
+
+	size_t GetQueryCount() const {
+		return offsets_.size() - 1;
+	}
+
+	// документы запроса query_index
+	IteratorRange<const Document*> GetQueryDocuments(size_t query_index) const {
+		return IteratorRange<const Document*>(GetQueryBegin(query_index), GetQueryEnd(query_index));
+	}
+
+private:
+	friend JoinedDocuments ProcessQueriesJoined(const SearchServer&, const std::vector<std::string>&);
+
+	std::vector<Document> documents_;
+	std::vector<size_t> offsets_; // offsets_[i] - документов в запросах [0, i)
+
+	const Document* GetQueryBegin(size_t query_index) const {
+		return documents_.data() + query_index * MAX_RESULT_DOCUMENT_COUNT;
+	}
+
+	const Document* GetQueryEnd(size_t query_index) const {
+		return GetQueryBegin(query_index) + (offsets_[query_index + 1] - offsets_[query_index]);
+	}
+};
+
 //распараллеливать обработку нескольких запросов к поисковой системе,
-//но возвращать набор документов в плоском виде.Объявление функции 
- std::vector<Document> ProcessQueriesJoined(
+//но возвращать набор документов в плоском виде: результаты пишутся сразу в общий буфер
+JoinedDocuments ProcessQueriesJoined(
 	const SearchServer& search_server,
 	const std::vector<std::string>& queries);
@@ -0,0 +1,62 @@
+#include "query_cache.h"
+
+#include <algorithm>
+
+QueryCache::QueryCache(size_t capacity, size_t shard_count)
+	: shards_(std::max<size_t>(shard_count, 1))
+	, shard_capacity_(std::max<size_t>(capacity / shards_.size(), 1)) {
+}
+
+std::optional<std::vector<Document>> QueryCache::Find(const std::string& key, uint64_t generation)
+{
+	Shard& shard = GetShard(key);
+	std::lock_guard guard(shard.mutex);
+	const auto it = shard.index.find(key);
+	if (it == shard.index.end()) {
+		++misses_;
+		return std::nullopt;
+	}
+	const auto entry = it->second;
+	if (entry->generation != generation) {
+		// индекс изменился после сохранения записи
+		shard.index.erase(it);
+		shard.entries.erase(entry);
+		++misses_;
+		return std::nullopt;
+	}
+	shard.entries.splice(shard.entries.begin(), shard.entries, entry);
+	++hits_;
+	return entry->documents;
+}
+
+void QueryCache::Insert(const std::string& key, uint64_t generation, const std::vector<Document>& documents)
+{
+	Shard& shard = GetShard(key);
+	std::lock_guard guard(shard.mutex);
+	const auto it = shard.index.find(key);
+	if (it != shard.index.end()) {
+		const auto entry = it->second;
+		entry->generation = generation;
+		entry->documents = documents;
+		shard.entries.splice(shard.entries.begin(), shard.entries, entry);
+		return;
+	}
+	shard.entries.push_front({ key, generation, documents });
+	shard.index.emplace(shard.entries.front().key, shard.entries.begin());
+	if (shard.entries.size() > shard_capacity_) {
+		shard.index.erase(shard.entries.back().key);
+		shard.entries.pop_back();
+	}
+}
+
+QueryCache::Stats QueryCache::GetStats() const
+{
+	Stats stats;
+	stats.hits = hits_;
+	stats.misses = misses_;
+	for (const Shard& shard : shards_) {
+		std::lock_guard guard(shard.mutex);
+		stats.size += shard.entries.size();
+	}
+	return stats;
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <cstdint>
+#include <atomic>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "document.h"
+
+// Кеш результатов поиска: сегменты с LRU-вытеснением, каждый под своей блокировкой.
+// Запись действительна, пока совпадает поколение индекса, с которым она сохранена -
+// поисковый сервер увеличивает поколение при каждом изменении, и старые записи перестают находиться.
+class QueryCache {
+public:
+	struct Stats {
+		uint64_t hits = 0;
+		uint64_t misses = 0;
+		size_t size = 0;
+	};
+
+	QueryCache(size_t capacity, size_t shard_count);
+
+	std::optional<std::vector<Document>> Find(const std::string& key, uint64_t generation);
+
+	void Insert(const std::string& key, uint64_t generation, const std::vector<Document>& documents);
+
+	Stats GetStats() const;
+
+private:
+	struct Entry {
+		std::string key;
+		uint64_t generation;
+		std::vector<Document> documents;
+	};
+	struct alignas(64) Shard {
+		mutable std::mutex mutex;
+		std::list<Entry> entries; // от недавно использованных к давно использованным
+		std::unordered_map<std::string_view, std::list<Entry>::iterator> index;
+	};
+
+	std::vector<Shard> shards_;
+	size_t shard_capacity_;
+	std::atomic<uint64_t> hits_ = 0;
+	std::atomic<uint64_t> misses_ = 0;
+
+	Shard& GetShard(const std::string& key) {
+		return shards_[std::hash<std::string>{}(key) % shards_.size()];
+	}
+};
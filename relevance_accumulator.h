@@ -0,0 +1,86 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <utility>
+#include <cstddef>
+
+// Накопитель релевантности для поиска.
+// Плотный массив по порядковым номерам документов разбит на непересекающиеся части,
+// каждую часть заполняет ровно один поток - ни блокировок, ни атомарных операций не нужно.
+// Для каждой части запоминаются затронутые номера: сбор результата проходит только по ним и обнуляет их ячейки,
+// поэтому между запросами массив остаётся нулевым, и запрос стоит O(записей в списках слов), а не O(документов).
+// Накопитель можно переиспользовать между запросами через Reset - массив выделяется заново, только если вырос.
+class RelevanceAccumulator {
+public:
+	RelevanceAccumulator() = default;
+
+	RelevanceAccumulator(size_t ordinal_count, size_t part_count) {
+		Reset(ordinal_count, part_count);
+	}
+
+	// готовит накопитель к новому поиску
+	void Reset(size_t ordinal_count, size_t part_count) {
+		if (ordinal_count > capacity_) {
+			slots_.reset(new Slot[ordinal_count]());
+			capacity_ = ordinal_count;
+			touched_.clear();
+		}
+		// прерванный поиск (дедлайн, исключение) не собрал свои части - обнуляем их ячейки здесь
+		for (auto& ordinals : touched_) {
+			for (const int ordinal : ordinals) {
+				slots_[ordinal] = Slot{};
+			}
+			ordinals.clear();
+		}
+		part_size_ = GetPartSize(ordinal_count, part_count);
+		ordinal_count_ = ordinal_count;
+		touched_.resize(std::max<size_t>(part_count, 1));
+	}
+
+	// части поровну, последняя может быть короче
+	static size_t GetPartSize(size_t ordinal_count, size_t part_count) {
+		part_count = std::max<size_t>(part_count, 1);
+		return (ordinal_count + part_count - 1) / part_count;
+	}
+
+	size_t GetPartCount() const {
+		return touched_.size();
+	}
+
+	// полуинтервал [first, second) порядковых номеров части
+	std::pair<int, int> GetPartRange(size_t part) const {
+		return { static_cast<int>(std::min(ordinal_count_, part * part_size_)),
+			static_cast<int>(std::min(ordinal_count_, (part + 1) * part_size_)) };
+	}
+
+	void Add(size_t part, int ordinal, double relevance) {
+		Slot& slot = slots_[ordinal];
+		if (!slot.matched) {
+			slot.matched = true;
+			touched_[part].push_back(ordinal);
+		}
+		slot.relevance += relevance;
+	}
+
+	// вызывает action(ordinal, relevance) для найденных документов части и обнуляет их ячейки
+	template <typename Action>
+	void ExtractMatched(size_t part, Action action) {
+		for (const int ordinal : touched_[part]) {
+			action(ordinal, slots_[ordinal].relevance);
+			slots_[ordinal] = Slot{};
+		}
+		touched_[part].clear();
+	}
+
+private:
+	struct Slot {
+		double relevance = 0.0;
+		bool matched = false;
+	};
+	std::unique_ptr<Slot[]> slots_;
+	size_t capacity_ = 0;
+	size_t part_size_ = 0;
+	size_t ordinal_count_ = 0;
+	std::vector<std::vector<int>> touched_;
+};
@@ -1,38 +1,155 @@
 #include "request_queue.h"
 
+#include <algorithm>
+#include <functional>
+#include <thread>
+
+RequestQueue::RequestQueue(const SearchServer& search_server, Clock::duration window, NowFunction now)
+	: search_server_(search_server)
+	, now_(now)
+	, start_(now_())
+	, bucket_duration_(std::max<Clock::duration>(window / BUCKET_COUNT, Clock::duration(1)))
+	, shards_(SHARD_COUNT)
+{
+}
+
 int RequestQueue::GetNoResultRequests() const
 {
-	return no_results_requests_;
+	return static_cast<int>(GetStats().no_result_count);
 }
 
 std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query, DocumentStatus status)
 {
-	const auto result = search_server_.FindTopDocuments(raw_query, status);
-	AddResult(result.size());
+	const Clock::time_point start = Clock::now();
+	auto result = search_server_.FindTopDocuments(raw_query, status);
+	AddResult(result.size(), Clock::now() - start);
 	return result;
 }
 
-std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query) 
+std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query)
 {
-	const auto result = search_server_.FindTopDocuments(raw_query);
-	AddResult(result.size());
+	const Clock::time_point start = Clock::now();
+	auto result = search_server_.FindTopDocuments(raw_query);
+	AddResult(result.size(), Clock::now() - start);
 	return result;
 }
 
-void RequestQueue::AddResult(int results_num)
+void RequestQueue::AddResult(size_t result_count, Clock::duration latency)
+{
+	const uint64_t time_index = GetTimeIndex(now_());
+	Shard& shard = shards_[std::hash<std::thread::id>()(std::this_thread::get_id()) % SHARD_COUNT];
+	Bucket& bucket = shard.buckets[time_index % BUCKET_COUNT];
+	// корзина с прошлого круга: первый записавший обнуляет счётчики, остальные ждут, пока он закончит
+	uint64_t bucket_time_index = bucket.time_index.load(std::memory_order_acquire);
+	while (bucket_time_index != time_index) {
+		if (bucket_time_index == RESETTING) {
+			bucket_time_index = bucket.time_index.load(std::memory_order_acquire);
+			continue;
+		}
+		if (bucket_time_index > time_index) {
+			// запись опоздала на целое окно - считаем её в более новую корзину
+			break;
+		}
+		if (bucket.time_index.compare_exchange_weak(bucket_time_index, RESETTING, std::memory_order_acquire)) {
+			bucket.request_count.store(0, std::memory_order_relaxed);
+			bucket.no_result_count.store(0, std::memory_order_relaxed);
+			for (auto& count : bucket.latency_counts) {
+				count.store(0, std::memory_order_relaxed);
+			}
+			bucket.time_index.store(time_index, std::memory_order_release);
+			break;
+		}
+	}
+	bucket.request_count.fetch_add(1, std::memory_order_relaxed);
+	if (result_count == 0) {
+		bucket.no_result_count.fetch_add(1, std::memory_order_relaxed);
+	}
+	const auto microseconds = std::chrono::duration_cast<std::chrono::microseconds>(latency).count();
+	bucket.latency_counts[GetLatencyBucket(static_cast<uint64_t>(std::max<decltype(microseconds)>(microseconds, 0)))]
+		.fetch_add(1, std::memory_order_relaxed);
+}
+
+RequestQueue::Stats RequestQueue::GetStats() const
 {
-		// новый запрос - новая секунда
-		++current_time_;
-		// удаляем все результаты поиска, которые устарели
-		while (!requests_.empty() && min_in_day_ <= current_time_ - requests_.front().timestamp) {
-			if (0 == requests_.front().results) {
-				--no_results_requests_;
+	Stats stats;
+	std::array<uint64_t, LATENCY_BUCKET_COUNT> latency_counts{};
+	ForEachActualBucket([&](const Bucket& bucket) {
+		stats.request_count += bucket.request_count.load(std::memory_order_relaxed);
+		stats.no_result_count += bucket.no_result_count.load(std::memory_order_relaxed);
+		for (size_t i = 0; i < LATENCY_BUCKET_COUNT; ++i) {
+			latency_counts[i] += bucket.latency_counts[i].load(std::memory_order_relaxed);
+		}
+	});
+
+	// учтённые корзины покрывают время от начала самой старой из них до сейчас,
+	// а пока с создания очереди прошло меньше окна - только время с создания
+	const Clock::time_point now = now_();
+	const Clock::duration since_start = now - start_;
+	const uint64_t time_index = GetTimeIndex(now);
+	const Clock::duration elapsed = since_start
+		- bucket_duration_ * static_cast<Clock::rep>(time_index > BUCKET_COUNT ? time_index - BUCKET_COUNT : 0);
+	if (elapsed > Clock::duration::zero()) {
+		stats.queries_per_second = stats.request_count / std::chrono::duration<double>(elapsed).count();
+	}
+
+	const auto get_percentile = [&](uint64_t percent) {
+		// номер запроса, задержка которого - искомый перцентиль
+		const uint64_t rank = (stats.request_count * percent + 99) / 100;
+		uint64_t count = 0;
+		for (size_t i = 0; i < LATENCY_BUCKET_COUNT; ++i) {
+			count += latency_counts[i];
+			if (count >= rank) {
+				return std::chrono::microseconds(GetLatencyBucketLimit(i));
 			}
-			requests_.pop_front();
 		}
-		// сохраняем новый результат поиска
-		requests_.push_back({ current_time_, results_num });
-		if (0 == results_num) {
-			++no_results_requests_;
+		return std::chrono::microseconds(0);
+	};
+	if (stats.request_count > 0) {
+		stats.latency_p50 = get_percentile(50);
+		stats.latency_p99 = get_percentile(99);
+	}
+	return stats;
+}
+
+uint64_t RequestQueue::GetTimeIndex(Clock::time_point time) const
+{
+	return static_cast<uint64_t>((time - start_) / bucket_duration_) + 1;
+}
+
+template <typename Action>
+void RequestQueue::ForEachActualBucket(Action action) const
+{
+	const uint64_t time_index = GetTimeIndex(now_());
+	for (const Shard& shard : shards_) {
+		for (const Bucket& bucket : shard.buckets) {
+			const uint64_t bucket_time_index = bucket.time_index.load(std::memory_order_acquire);
+			if (bucket_time_index != 0 && bucket_time_index != RESETTING && time_index - bucket_time_index < BUCKET_COUNT) {
+				action(bucket);
+			}
 		}
-}
\ No newline at end of file
+	}
+}
+
+size_t RequestQueue::GetLatencyBucket(uint64_t microseconds)
+{
+	if (microseconds < 4) {
+		return static_cast<size_t>(microseconds);
+	}
+	// старший бит - степень двойки, два следующих - четверть внутри неё
+	size_t exponent = 2;
+	while ((microseconds >> (exponent + 1)) != 0) {
+		++exponent;
+	}
+	const size_t quarter = (microseconds >> (exponent - 2)) & 3;
+	return std::min(4 * (exponent - 1) + quarter, LATENCY_BUCKET_COUNT - 1);
+}
+
+uint64_t RequestQueue::GetLatencyBucketLimit(size_t latency_bucket)
+{
+	if (latency_bucket < 4) {
+		return latency_bucket;
+	}
+	const size_t exponent = latency_bucket / 4 + 1;
+	const uint64_t quarter = latency_bucket % 4;
+	return ((4 + quarter + 1) << (exponent - 2)) - 1;
+}
@@ -2,19 +2,38 @@
 
 #include <vector>
 #include <string>
-#include <deque>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 
 #include "search_server.h"
+
+// Статистика поисковых запросов за скользящее окно времени: число запросов без результата,
+// задержки (p50, p99) и QPS. Окно делится на BUCKET_COUNT корзин по времени, корзина переиспользуется по кругу,
+// поэтому окно сдвигается шагами в window / BUCKET_COUNT. Счётчики - атомарные и разложены по сегментам:
+// поток пишет в сегмент, выбранный по его id, поэтому потоки почти не делят кеш-линии и пишут без блокировок.
+// Блокируются только записи в корзину, которую в этот момент обнуляют для нового отрезка времени.
 class RequestQueue {
 public:
-	explicit RequestQueue(const SearchServer& search_server)
-		: search_server_(search_server)
-		, no_results_requests_(0)
-		, current_time_(0) {
-	}
-	~RequestQueue() {}
-
-	// сделаем "обертки" для всех методов поиска, чтобы сохранять результаты для нашей статистики
+	using Clock = std::chrono::steady_clock;
+	// источник текущего времени для окна; тесты подставляют свои часы, чтобы сдвигать окно без ожидания
+	using NowFunction = Clock::time_point (*)();
+
+	struct Stats {
+		uint64_t request_count = 0;
+		uint64_t no_result_count = 0;
+		double queries_per_second = 0.0;
+		// оценка сверху с точностью до четверти значения
+		std::chrono::microseconds latency_p50{ 0 };
+		std::chrono::microseconds latency_p99{ 0 };
+	};
+
+	explicit RequestQueue(const SearchServer& search_server, Clock::duration window = std::chrono::hours(24),
+		NowFunction now = Clock::now);
+
+	// сделаем "обертки" для всех методов поиска, чтобы сохранять результаты для нашей статистики.
+	// можно вызывать из нескольких потоков
 	template <typename DocumentPredicate>
 	std::vector<Document> AddFindRequest(const std::string& raw_query, DocumentPredicate document_predicate);
 
@@ -22,24 +41,55 @@ public:
 
 	std::vector<Document> AddFindRequest(const std::string& raw_query);
 
+	// записывает запрос, выполненный в обход AddFindRequest
+	void AddResult(size_t result_count, Clock::duration latency);
+
+	// запросов без результата за окно
 	int GetNoResultRequests() const;
+
+	Stats GetStats() const;
+
 private:
-	struct QueryResult {
-		uint64_t timestamp;
-		int results;
+	static constexpr size_t SHARD_COUNT = 16;
+	static constexpr size_t BUCKET_COUNT = 60;
+	// задержки в микросекундах: 4 корзины на каждую степень двойки, до ~30 секунд
+	static constexpr size_t LATENCY_BUCKET_COUNT = 100;
+	// номер отрезка корзины, пока её счётчики обнуляются
+	static constexpr uint64_t RESETTING = UINT64_MAX;
+
+	struct Bucket {
+		std::atomic<uint64_t> time_index{ 0 }; // номер отрезка времени, к которому относятся счётчики, или RESETTING
+		std::atomic<uint64_t> request_count{ 0 };
+		std::atomic<uint64_t> no_result_count{ 0 };
+		std::array<std::atomic<uint64_t>, LATENCY_BUCKET_COUNT> latency_counts{};
+	};
+
+	struct alignas(64) Shard {
+		std::array<Bucket, BUCKET_COUNT> buckets;
 	};
-	std::deque<QueryResult> requests_;
+
 	const SearchServer& search_server_;
-	int no_results_requests_;
-	uint64_t current_time_;
-	const static int min_in_day_ = 1440;
+	const NowFunction now_;
+	const Clock::time_point start_;
+	const Clock::duration bucket_duration_;
+	std::vector<Shard> shards_;
 
-	void AddResult(int results_num);
+	// номер отрезка времени от создания очереди; отрезки нумеруются с 1, 0 - корзина ещё не использовалась
+	uint64_t GetTimeIndex(Clock::time_point time) const;
+
+	template <typename Action>
+	void ForEachActualBucket(Action action) const;
+
+	static size_t GetLatencyBucket(uint64_t microseconds);
+	// верхняя граница задержек корзины
+	static uint64_t GetLatencyBucketLimit(size_t latency_bucket);
 };
+
 template <typename DocumentPredicate>
 std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query, DocumentPredicate document_predicate)
 {
-	const auto result = search_server_.FindTopDocuments(raw_query, document_predicate);
-	AddResult(result.size());
+	const Clock::time_point start = Clock::now();
+	auto result = search_server_.FindTopDocuments(raw_query, document_predicate);
+	AddResult(result.size(), Clock::now() - start);
 	return result;
 }
@@ -10,27 +10,140 @@ using namespace std;
 void SearchServer::AddDocument(int document_id, std::string_view document,
 	DocumentStatus status, const std::vector<int>& ratings) {
 
-	if ((document_id < 0) || (documents_.count(document_id) > 0)) {
+	if ((document_id < 0) || (id_to_ordinal_.count(document_id) > 0)) {
 		throw invalid_argument("Invalid document_id"s);
 	}
 
-	//записали документ, как строку в DocumentData
-	documents_.emplace(document_id, DocumentData{ ComputeAverageRating(ratings), status, string(document) });
-	document_ids_.insert(document_id);
+	//разбили документ на слова до изменения индекса, чтобы исключение не оставило документ добавленным наполовину
+	const auto word_freqs = ComputeWordFreqs(document);
+
+	++generation_;
+	const int ordinal = AddDocumentData(document_id, ComputeAverageRating(ratings), status, document);
+
+	TermFreqs& terms = ordinal_to_terms_.Edit(ordinal);
+	terms.reserve(word_freqs.size());
+	for (const auto& [word, term_freq] : word_freqs)
+	{
+		const InvertedIndex::TermId term_id = word_to_document_.AddTerm(word);
+		const InvertedIndex::FreqCode freq_code = word_to_document_.AddTermFreq(term_freq);
+		word_to_document_.AddPosting(term_id, ordinal, freq_code);
+		terms.push_back({ term_id, freq_code });
+	}
+	std::sort(terms.begin(), terms.end());
+}
 
-	//передали документ
-	const auto words = SplitIntoWordsNoStop( static_cast<std::string_view>(documents_.at(document_id).document));
+std::map<std::string_view, double> SearchServer::ComputeWordFreqs(std::string_view document) const
+{
+	const auto words = SplitIntoWordsNoStop(document);
 	const double inv_word_count = 1.0 / words.size();
 
+	std::map<std::string_view, double> word_freqs;
 	for (std::string_view word : words)
 	{
-		word_to_document_[word][document_id] += inv_word_count;
-		document_to_word_[document_id][word_to_document_.find(word)->first] += inv_word_count;
+		word_freqs[word] += inv_word_count;
 	}
+	return word_freqs;
 }
 
 int SearchServer::GetDocumentCount() const {
-	return documents_.size();
+	return static_cast<int>(document_ids_.size());
+}
+
+int SearchServer::FindOrdinal(int document_id) const
+{
+	const auto it = id_to_ordinal_.find(document_id);
+	return it != id_to_ordinal_.end() ? it->second : -1;
+}
+
+int SearchServer::AddDocumentData(int document_id, int rating, DocumentStatus status, std::string_view text)
+{
+	const int ordinal = static_cast<int>(ordinal_to_id_.size());
+	ordinal_to_id_.push_back(document_id);
+	ratings_.push_back(rating);
+	statuses_.push_back(status);
+	text_refs_.push_back(text_store_.Add(text));
+	ordinal_to_terms_.emplace_back();
+	id_to_ordinal_.emplace(document_id, ordinal);
+	document_ids_.insert(document_id);
+	status_to_documents_[static_cast<size_t>(status)].Set(ordinal);
+	return ordinal;
+}
+
+void SearchServer::MarkDocumentRemoved(int ordinal)
+{
+	++generation_;
+	for (const auto& term : ordinal_to_terms_.Get(ordinal)) {
+		word_to_document_.MarkRemoved(term.term_id);
+	}
+	ordinal_to_terms_.Clear(ordinal);
+	status_to_documents_[static_cast<size_t>(statuses_[ordinal])].Reset(ordinal);
+	removed_documents_.Set(ordinal);
+	text_refs_[ordinal] = {};
+	id_to_ordinal_.erase(ordinal_to_id_[ordinal]);
+	document_ids_.erase(ordinal_to_id_[ordinal]);
+	ordinal_to_id_[ordinal] = -1;
+}
+
+std::vector<int> SearchServer::ComputeCompactOrdinals() const
+{
+	// порядок живых документов не меняется, списки остаются отсортированными
+	vector<int> new_ordinals(ordinal_to_id_.size(), -1);
+	int ordinal_count = 0;
+	for (size_t ordinal = 0; ordinal < ordinal_to_id_.size(); ++ordinal) {
+		if (ordinal_to_id_[ordinal] >= 0) {
+			new_ordinals[ordinal] = ordinal_count++;
+		}
+	}
+	return new_ordinals;
+}
+
+void SearchServer::RemapDocumentData(const std::vector<int>& new_ordinals)
+{
+	for (auto& bitmap : status_to_documents_) {
+		bitmap = DocumentBitmap();
+	}
+	removed_documents_ = DocumentBitmap();
+	ordinal_to_terms_.Unmap();
+	const size_t ordinal_count = document_ids_.size();
+	for (size_t ordinal = 0; ordinal < new_ordinals.size(); ++ordinal) {
+		const int new_ordinal = new_ordinals[ordinal];
+		if (new_ordinal < 0) {
+			continue;
+		}
+		if (static_cast<size_t>(new_ordinal) != ordinal) {
+			ordinal_to_id_[new_ordinal] = ordinal_to_id_[ordinal];
+			ratings_[new_ordinal] = ratings_[ordinal];
+			statuses_[new_ordinal] = statuses_[ordinal];
+			text_refs_[new_ordinal] = text_refs_[ordinal];
+			ordinal_to_terms_.Edit(new_ordinal) = std::move(ordinal_to_terms_.Edit(ordinal));
+			id_to_ordinal_[ordinal_to_id_[new_ordinal]] = new_ordinal;
+		}
+		status_to_documents_[static_cast<size_t>(statuses_[new_ordinal])].Set(new_ordinal);
+	}
+	ordinal_to_id_.resize(ordinal_count);
+	ratings_.resize(ordinal_count);
+	statuses_.resize(ordinal_count);
+	text_refs_.resize(ordinal_count);
+	ordinal_to_terms_.resize(ordinal_count);
+	text_store_.Compact(text_refs_);
+}
+
+void SearchServer::SetTextStorage(DocumentTextStore::Mode mode, const std::string& path)
+{
+	DocumentTextStore text_store(mode, path);
+	for (DocumentTextStore::TextRef& ref : text_refs_) {
+		ref = text_store.Add(text_store_.Get(ref));
+	}
+	text_store_ = std::move(text_store);
+}
+
+std::string SearchServer::GetDocumentText(int document_id) const
+{
+	const int ordinal = FindOrdinal(document_id);
+	if (ordinal < 0) {
+		throw invalid_argument("Invalid document_id"s);
+	}
+	return text_store_.Get(text_refs_[ordinal]);
 }
 
 std::set<int>::iterator SearchServer::begin() const {
@@ -41,14 +154,17 @@ std::set<int>::iterator SearchServer::end() const {
 	return document_ids_.end();
 }
 
-const std::map<std::string_view, double>& SearchServer::GetWordFrequencies(int document_id) const
+std::map<std::string_view, double> SearchServer::GetWordFrequencies(int document_id) const
 {
-	//O(log N)O(logN)
-	const static std::map<std::string_view, double> empty_results = {};
-	if (document_ids_.count(document_id) == 0) {
-		return empty_results;
+	std::map<std::string_view, double> word_freqs;
+	const int ordinal = FindOrdinal(document_id);
+	if (ordinal < 0) {
+		return word_freqs;
+	}
+	for (const auto& [term_id, freq_code] : ordinal_to_terms_.Get(ordinal)) {
+		word_freqs.emplace(word_to_document_.GetTerm(term_id), word_to_document_.GetTermFreq(freq_code));
 	}
-	return document_to_word_.at(document_id);
+	return word_freqs;
 }
 
 void SearchServer::RemoveDocument(int document_id)
@@ -56,10 +172,39 @@ void SearchServer::RemoveDocument(int document_id)
 	RemoveDocument(std::execution::seq, document_id);
 }
 
+void SearchServer::RemoveDocuments(const std::vector<int>& document_ids)
+{
+	RemoveDocuments(std::execution::seq, document_ids);
+}
+
+void SearchServer::Compact()
+{
+	Compact(std::execution::seq);
+}
+
+std::vector<int> SearchServer::RemoveDuplicates()
+{
+	return RemoveDuplicates(std::execution::seq);
+}
+
+uint64_t SearchServer::ComputeTermSetFingerprint(const ForwardIndex::Terms& terms)
+{
+	// номера слов отсортированы, поэтому одинаковые наборы дают одинаковую последовательность
+	uint64_t hash = terms.size();
+	for (const auto& term : terms) {
+		hash ^= term.term_id + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2);
+		hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9ull;
+		hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebull;
+		hash ^= hash >> 31;
+	}
+	return hash;
+}
+
 SearchServer::ReturnMatch SearchServer::MatchDocument(std::string_view raw_query,
 	int document_id) const
 {
-	if ((document_id < 0) || !documents_.count(document_id)) {
+	const int ordinal = FindOrdinal(document_id);
+	if ((document_id < 0) || ordinal < 0) {
 		throw invalid_argument("Invalid document_id"s);
 	}
 
@@ -69,22 +214,18 @@ SearchServer::ReturnMatch SearchServer::MatchDocument(std::string_view raw_query
 	//обработка минус слов
 	//если в документе есть минус слово возвращаем пустой результат
 	for (auto& word : query.minus_words) {
-		if (word_to_document_.count(word) == 0) {
-			continue;
-		}
-		if (word_to_document_.at(word).count(document_id)) {
+		const auto postings = word_to_document_.Find(word);
+		if (postings != nullptr && postings->Contains(ordinal)) {
 			matched_words.clear();
-			return { matched_words, documents_.at(document_id).status };
+			return { matched_words, statuses_[ordinal] };
 		}
 	}
 	//проверка на плюс слова
 	matched_words.reserve(query.plus_words.size());
 
 	for (auto& word : query.plus_words) {
-		if (word_to_document_.count(word) == 0) {
-			continue;
-		}
-		if (word_to_document_.at(word).count(document_id)) {
+		const auto postings = word_to_document_.Find(word);
+		if (postings != nullptr && postings->Contains(ordinal)) {
 			matched_words.push_back(word);
 		}
 	}
@@ -93,7 +234,7 @@ SearchServer::ReturnMatch SearchServer::MatchDocument(std::string_view raw_query
 	auto range_end = std::unique(execution::par, matched_words.begin(), matched_words.end());
 	matched_words.erase(range_end, matched_words.end());
 
-	return { matched_words, documents_.at(document_id).status };
+	return { matched_words, statuses_[ordinal] };
 }
 
 SearchServer::ReturnMatch SearchServer::MatchDocument(const std::execution::sequenced_policy&,
@@ -105,12 +246,20 @@ SearchServer::ReturnMatch SearchServer::MatchDocument(const std::execution::sequ
 SearchServer::ReturnMatch  SearchServer::MatchDocument(const std::execution::parallel_policy&,
 	std::string_view raw_query, int document_id) const
 {
-	if ((document_id < 0) || !documents_.count(document_id)) {
+	const int ordinal = FindOrdinal(document_id);
+	if ((document_id < 0) || ordinal < 0) {
 		throw invalid_argument("Invalid document_id"s);
 	}
 
 	const auto query = ParseQueryVector(raw_query);
 	std::vector<std::string_view> matched_words{};
+	const ForwardIndex::Terms terms = ordinal_to_terms_.Get(ordinal);
+	const auto contains = [&](std::string_view word) {
+		const InvertedIndex::TermId term_id = word_to_document_.FindTermId(word);
+		const auto it = std::lower_bound(terms.begin(), terms.end(), term_id,
+			[](const auto& term, InvertedIndex::TermId id) { return term.term_id < id; });
+		return it != terms.end() && it->term_id == term_id;
+	};
 
 	//обработка минус слов
 	//если в документе есть минус слово возвращаем пустой результат
@@ -118,8 +267,8 @@ SearchServer::ReturnMatch  SearchServer::MatchDocument(const std::execution::par
 		query.minus_words.begin(),
 		query.minus_words.end(),
 		[&](const auto &word)
-	{ return document_to_word_.at(document_id).count(word) != 0; 	}))
-		return { matched_words, documents_.at(document_id).status };
+	{ return contains(word); }))
+		return { matched_words, statuses_[ordinal] };
 	//обработка плюс слов
 
 	matched_words.reserve(query.plus_words.size());
@@ -128,19 +277,27 @@ SearchServer::ReturnMatch  SearchServer::MatchDocument(const std::execution::par
 		query.plus_words.end(),
 		std::back_inserter(matched_words),
 		[&](const auto &word) {
-		return document_to_word_.at(document_id).count(word) != 0; });
+		return contains(word); });
 
 	//сортируем и упорядочеваем к выдаче
 	std::sort(execution::par, matched_words.begin(), matched_words.end());
 	auto range_end = std::unique(execution::par, matched_words.begin(), matched_words.end());
 	matched_words.erase(range_end, matched_words.end());
 
-	return { matched_words, documents_.at(document_id).status };
+	return { matched_words, statuses_[ordinal] };
+}
+
+bool SearchServer::IsMoreRelevant(const Document& lhs, const Document& rhs)
+{
+	if (std::abs(lhs.relevance - rhs.relevance) < EXP) {
+		return lhs.rating > rhs.rating;
+	}
+	return lhs.relevance > rhs.relevance;
 }
 
 bool SearchServer::IsStopWord(std::string_view word) const
 {
-	return stop_words_.count(word) > 0;
+	return stop_word_lookup_.count(word) > 0;
 }
 
 bool SearchServer::IsValidWord(std::string_view word)
@@ -153,15 +310,16 @@ bool SearchServer::IsValidWord(std::string_view word)
 std::vector<std::string_view> SearchServer::SplitIntoWordsNoStop(std::string_view text) const
 {
 	std::vector<std::string_view> words;
-	for (std::string_view word: SplitIntoWordsView(text))
-	{
-		if (!IsValidWord(word)) {
-			throw invalid_argument("Word "s + string(word) + " is invalid"s);
-		}
-		if (!IsStopWord(word)) {
-			words.push_back(word);
+	// границы слов и управляющие символы находятся за один проход, слова проверяются заново только для текста ошибки
+	if (!SplitIntoWordsChecked(text, words)) {
+		for (std::string_view word : words) {
+			if (!IsValidWord(word)) {
+				throw invalid_argument("Word "s + string(word) + " is invalid"s);
+			}
 		}
 	}
+	words.erase(std::remove_if(words.begin(), words.end(),
+		[this](std::string_view word) { return IsStopWord(word); }), words.end());
 	return words;
 }
 
@@ -191,24 +349,74 @@ SearchServer::QueryWord SearchServer::ParseQueryWord(std::string_view text) cons
 	if (is_minus && text[0] == '-') {
 		throw invalid_argument("Query has incorrect minus-words."s);
 	}
-	return { text, is_minus, IsStopWord(static_cast<string>(text)) };
+	return { text, is_minus, IsStopWord(text) };
 }
 
 SearchServer::QueryVector SearchServer::ParseQueryVector(std::string_view text) const
 {
 	QueryVector result;
-	for (auto& word : SplitIntoWordsView(text))
-	{
+	ForEachWordView(text, [this, &result](std::string_view word) {
 		const auto query_word = ParseQueryWord(word);
 		if (!query_word.is_stop) {
 			(query_word.is_minus) ? result.minus_words.push_back(query_word.data) : result.plus_words.push_back(query_word.data);
 		}
+	});
+	//сортируем и упорядочеваем + и - слова
+	for (auto* words : { &result.plus_words, &result.minus_words }) {
+		std::sort(words->begin(), words->end());
+		words->erase(std::unique(words->begin(), words->end()), words->end());
 	}
 	return result;
 }
 
-// Existence required
-double SearchServer::ComputeWordInverseDocumentFreq(string_view word) const
+std::string SearchServer::MakeResultCacheKey(const QueryVector& query, DocumentStatus status, size_t max_count)
+{
+	// управляющие символы не могут встретиться в словах запроса
+	std::string key = std::to_string(static_cast<int>(status)) + '\x01' + std::to_string(max_count);
+	for (std::string_view word : query.plus_words) {
+		key += '\x02';
+		key += word;
+	}
+	for (std::string_view word : query.minus_words) {
+		key += '\x03';
+		key += word;
+	}
+	return key;
+}
+
+void SearchServer::EnableResultCache(size_t capacity)
+{
+	result_cache_ = std::make_unique<QueryCache>(capacity, STREAM_MAX);
+}
+
+void SearchServer::DisableResultCache()
+{
+	result_cache_.reset();
+}
+
+QueryCache::Stats SearchServer::GetResultCacheStats() const
+{
+	return result_cache_ ? result_cache_->GetStats() : QueryCache::Stats{};
+}
+
+void SearchServer::MergePartDocuments(std::vector<std::vector<Document>>& part_documents, std::vector<Document>& documents)
+{
+	documents.clear();
+	if (part_documents.size() == 1) {
+		documents.swap(part_documents.front());
+		return;
+	}
+	size_t total_count = 0;
+	for (const auto& part : part_documents) {
+		total_count += part.size();
+	}
+	documents.reserve(total_count);
+	for (const auto& part : part_documents) {
+		documents.insert(documents.end(), part.begin(), part.end());
+	}
+}
+
+double SearchServer::ComputeWordInverseDocumentFreq(const InvertedIndex::PostingList& postings) const
 {
-	return log(GetDocumentCount() * 1.0 / word_to_document_.at(std::string(word)).size());
+	return postings.GetInverseDocumentFreq(GetDocumentCount());
 }
@@ -5,80 +5,201 @@
 #include <tuple>
 #include <map>
 #include <set>
+#include <queue>
+#include <array>
+#include <limits>
+#include <unordered_set>
 #include <cmath>
 #include <algorithm>
 #include <string_view>
 #include <execution>
 #include <list>
+#include <numeric>
+#include <type_traits>
+#include <thread>
+#include <exception>
+#include <memory>
+#include <memory_resource>
+#include <chrono>
+#include <atomic>
 
 #include "document.h"
 #include "string_processing.h"
+#include "inverted_index.h"
+#include "forward_index.h"
+#include "relevance_accumulator.h"
+#include "query_cache.h"
+#include "small_vector.h"
+#include "document_bitmap.h"
+#include "document_text_store.h"
 #include "concurrent_map.h"
 
 using namespace std::literals;
 
+namespace index_file {
+class MappedFile;
+}
+
 const int MAX_RESULT_DOCUMENT_COUNT = 5;
 const double EXP = 1e-6;
 const int STREAM_MAX = 16;
 
+// поиск не уложился в дедлайн, заданный в SearchServer::QueryScratch
+class QueryDeadlineExceeded : public std::runtime_error {
+public:
+	QueryDeadlineExceeded()
+		: std::runtime_error("Query deadline exceeded") {
+	}
+};
+
 class SearchServer {
 public:
-	// Конструктор принимающий контейнер
+	// Конструктор принимающий контейнер.
+	// resource - память индексов (словарь, списки документов, прямой индекс); должен пережить сервер,
+	// при пакетном добавлении и параллельном удалении - потокобезопасный (например, synchronized_pool_resource)
 	template <typename StringContainer>
-	explicit SearchServer(const StringContainer& stop_words);
+	explicit SearchServer(const StringContainer& stop_words,
+		std::pmr::memory_resource* resource = std::pmr::get_default_resource());
 
 	// Конструктор константной строки
-	explicit SearchServer(const std::string& stop_words_text) :
-	SearchServer(static_cast<std::string_view>(stop_words_text)) {}
+	explicit SearchServer(const std::string& stop_words_text,
+		std::pmr::memory_resource* resource = std::pmr::get_default_resource()) :
+	SearchServer(static_cast<std::string_view>(stop_words_text), resource) {}
 
 	// Конструктор string_view
-	SearchServer(std::string_view stop_words_text) :
-		SearchServer(SplitIntoWordsView(stop_words_text)) {}
+	SearchServer(std::string_view stop_words_text,
+		std::pmr::memory_resource* resource = std::pmr::get_default_resource()) :
+		SearchServer(SplitIntoWordsView(stop_words_text), resource) {}
 
 	//функция добавления документов
 	void AddDocument(int document_id, std::string_view document, DocumentStatus status,
 		const std::vector<int>& ratings);
+
+	//пакетное добавление: документы разбиваются на слова параллельно и вливаются в индекс за один проход.
+	//если хотя бы один документ некорректен, исключение выбрасывается до изменения сервера
+	template <typename Execution>
+	void AddDocuments(Execution&& policy, const std::vector<RawDocument>& documents);
 	
 	//по запросу, без фильтраций
+	//max_count - сколько лучших документов вернуть
 	//1
 	template <typename DocumentPredicate>
 	std::vector<Document> FindTopDocuments(std::string_view raw_query,
-		DocumentPredicate document_predicate) const;
+		DocumentPredicate document_predicate, size_t max_count = MAX_RESULT_DOCUMENT_COUNT) const;
 	//2
 	template <typename Execution,typename DocumentPredicate>
 	std::vector<Document> FindTopDocuments(Execution&& policy,
-		std::string_view raw_query, DocumentPredicate document_predicate) const;
+		std::string_view raw_query, DocumentPredicate document_predicate,
+		size_t max_count = MAX_RESULT_DOCUMENT_COUNT) const;
 	//с фильтрацией по статусу и по произвольному предикату
 	//3
 	std::vector<Document> FindTopDocuments(std::string_view raw_query,
-		DocumentStatus status = DocumentStatus::ACTUAL) const {
-		return FindTopDocuments(raw_query, [status](int document_id, DocumentStatus document_status, int rating) {
-			return document_status == status; });
+		DocumentStatus status = DocumentStatus::ACTUAL, size_t max_count = MAX_RESULT_DOCUMENT_COUNT) const {
+		return FindTopDocumentsByStatus(std::execution::seq, raw_query, status, max_count);
 	}
 	//4
 	template <typename Execution>
 	std::vector<Document> FindTopDocuments(Execution&& policy,
-		std::string_view raw_query, DocumentStatus status = DocumentStatus::ACTUAL) const {
-		return FindTopDocuments(policy, raw_query,[status](int document_id, DocumentStatus document_status, int rating) {
-			return document_status == status; });
+		std::string_view raw_query, DocumentStatus status = DocumentStatus::ACTUAL,
+		size_t max_count = MAX_RESULT_DOCUMENT_COUNT) const {
+		return FindTopDocumentsByStatus(policy, raw_query, status, max_count);
+	}
+
+	// буферы поиска, которые переиспользуются между запросами: накопитель релевантности и векторы кандидатов
+	// не выделяются на каждый запрос заново. Один объект используется одним запросом за раз.
+	// если задан дедлайн, поиск проверяет часы по ходу перебора документов и, не успев, выбрасывает QueryDeadlineExceeded
+	class QueryScratch {
+	public:
+		void SetDeadline(std::chrono::steady_clock::time_point deadline) {
+			deadline_ = deadline;
+		}
+
+		void ResetDeadline() {
+			deadline_ = std::chrono::steady_clock::time_point::max();
+		}
+
+	private:
+		friend class SearchServer;
+		RelevanceAccumulator accumulator_;
+		std::vector<std::vector<Document>> part_documents_; // кандидаты частей поиска
+		std::vector<Document> candidates_;
+		std::chrono::steady_clock::time_point deadline_ = std::chrono::steady_clock::time_point::max();
+	};
+
+	//как перегрузка 4, но промежуточные буферы берутся из scratch
+	//5
+	template <typename Execution>
+	std::vector<Document> FindTopDocuments(Execution&& policy, QueryScratch& scratch,
+		std::string_view raw_query, DocumentStatus status = DocumentStatus::ACTUAL,
+		size_t max_count = MAX_RESULT_DOCUMENT_COUNT) const {
+		return FindTopDocumentsByStatus(policy, raw_query, status, max_count, &scratch);
 	}
 
+	//как перегрузка 5, но лучшие документы пишутся в output (не меньше max_count ячеек), а не в вектор результата.
+	//возвращает число записанных документов
+	//6
+	template <typename Execution>
+	size_t FindTopDocuments(Execution&& policy, QueryScratch& scratch, std::string_view raw_query, Document* output,
+		DocumentStatus status = DocumentStatus::ACTUAL, size_t max_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+	// кеш результатов поиска по статусу (перегрузки 3, 4 и 5), capacity - число запомненных запросов.
+	// запросы с произвольным предикатом в кеш не попадают, любое изменение документов делает записи устаревшими
+	void EnableResultCache(size_t capacity);
+
+	void DisableResultCache();
+
+	QueryCache::Stats GetResultCacheStats() const;
+
 	int GetDocumentCount() const;
 
+	bool HasDocument(int document_id) const {
+		return FindOrdinal(document_id) >= 0;
+	}
+
 	std::set<int>::iterator begin() const;
 
 	std::set<int>::iterator end() const;
 
-	//метод получения частот слов по id документа, eсли документа не существует, возвратите ссылку на пустой map
-	const std::map<std::string_view, double>& GetWordFrequencies(int document_id) const;
+	//метод получения частот слов по id документа, eсли документа не существует, возвращает пустой map.
+	//внутри слова хранятся номерами, словарь со строками собирается при вызове
+	std::map<std::string_view, double> GetWordFrequencies(int document_id) const;
 
-	// метод удаления документов из поискового сервера
+	// где хранить тексты документов: в памяти (по умолчанию), в файле path или нигде.
+	// для поиска тексты не нужны; уже сохранённые тексты переносятся в новое хранилище
+	void SetTextStorage(DocumentTextStore::Mode mode, const std::string& path = {});
+
+	// текст документа из хранилища; пустая строка, если тексты не хранятся
+	std::string GetDocumentText(int document_id) const;
+
+	// метод удаления документов из поискового сервера.
+	// документ только помечается удалённым, записи в списках слов убирает Compact
 	void RemoveDocument(int document_id);
 
-	//метод удаления документов из поискового сервера, многопоточный
+	//метод удаления документов из поискового сервера, policy используется при уплотнении
 	template<class Execution>
 	void RemoveDocument(Execution&& policy, int document_id);
 
+	//пакетное удаление: документы помечаются удалёнными, уплотнение проверяется один раз в конце.
+	//отсутствующие id пропускаются
+	void RemoveDocuments(const std::vector<int>& document_ids);
+
+	template<class Execution>
+	void RemoveDocuments(Execution&& policy, const std::vector<int>& document_ids);
+
+	//удаляет дубликаты - документы с тем же набором слов, что у документа с меньшим id.
+	//возвращает удалённые id по возрастанию
+	std::vector<int> RemoveDuplicates();
+
+	template<class Execution>
+	std::vector<int> RemoveDuplicates(Execution&& policy);
+
+	//убирает из списков слов записи удалённых документов и перенумеровывает документы подряд.
+	//вызывается сам, когда удалённых больше половины; списки разных слов перестраиваются параллельно
+	void Compact();
+
+	template<class Execution>
+	void Compact(Execution&& policy);
+
 	using ReturnMatch = std::tuple<std::vector<std::string_view>, DocumentStatus>;
 	// возвращает пару из вектора слов и структуры DocumentStatus, по запросу query
 	//1
@@ -91,17 +212,40 @@ public:
 	ReturnMatch MatchDocument(const std::execution::parallel_policy& policy,
 		std::string_view raw_query, int document_id) const;
 
+	// сохраняет стоп-слова, словарь, списки документов и документы в двоичный файл (формат в index_file.h).
+	// файл пишется рядом под именем path + ".tmp" и затем переименовывается, поэтому прежний файл остаётся целым при сбое
+	void Save(const std::string& path) const;
+
+	// загружает сервер из файла Save. Файл отображается в память, списки слов, прямой индекс и тексты читаются
+	// прямо из него и копируются только при изменении, поэтому время загрузки растёт с числом слов и документов,
+	// а не записей в списках. Проверяются заголовок, границы секций, таблицы блоков и столбцы документов;
+	// сжатые блоки не распаковываются, поэтому файл должен быть записан Save
+	static SearchServer Load(const std::string& path,
+		std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
 private:
-	struct DocumentData {
-		int rating;
-		DocumentStatus status;
-		std::string document;
-	};
+	// частоты слов документа, по возрастанию номера слова
+	using TermFreqs = ForwardIndex::TermFreqs;
+
+	// файл, из которого загружен сервер; на него ссылаются слова словаря, списки, прямой индекс и тексты
+	std::shared_ptr<const index_file::MappedFile> mapped_file_;
 	std::set<std::string, std::less<>> stop_words_;        // множество стоп слов
-	std::map<std::string_view, std::map<int, double>> word_to_document_; // словарь слов  map<слово, map<id, частота>>   std::less<>
-	std::map<int, std::map<std::string_view, double>> document_to_word_; // словарь слов  map<id, map<слово, частота>>
-	std::map<int, DocumentData> documents_; // словарь документов <document_id, DocumentData<rating,status,document>>
-	std::set<int> document_ids_; // множество id документов на сервере
+	std::unordered_set<std::string_view> stop_word_lookup_; // те же стоп слова для поиска по хешу
+	InvertedIndex word_to_document_; // обратный индекс  слово -> списки <порядковый номер, частота>
+	ForwardIndex ordinal_to_terms_; // прямой индекс  порядковый номер документа -> частоты слов
+	// данные документов хранятся столбцами по внутреннему порядковому номеру, у удалённых номеров id = -1.
+	// номера выдаются по возрастанию; когда удалённых становится больше половины, номера уплотняются
+	std::vector<int> ordinal_to_id_;
+	std::vector<int> ratings_;
+	std::vector<DocumentStatus> statuses_;
+	std::vector<DocumentTextStore::TextRef> text_refs_;
+	DocumentTextStore text_store_;
+	std::pmr::unordered_map<int, int> id_to_ordinal_; // id документа -> порядковый номер
+	std::set<int> document_ids_; // id документов по возрастанию для обхода сервера
+	std::array<DocumentBitmap, 4> status_to_documents_; // статус -> порядковые номера документов с этим статусом
+	DocumentBitmap removed_documents_; // удалённые номера, записи которых ещё остались в списках слов
+	std::unique_ptr<QueryCache> result_cache_; // nullptr, если кеш выключен
+	uint64_t generation_ = 0; // номер изменения документов, по нему отбрасываются устаревшие записи кеша
 
 	struct QueryWord {
 		std::string_view data;
@@ -109,9 +253,15 @@ private:
 		bool is_stop;
 	};
 
+	// типичный запрос помещается во внутренний буфер и не выделяет память
+	static const size_t QUERY_INLINE_WORD_COUNT = 16;
+	// поиск без накопителя, если записей в списках плюс слов меньше документов в это число раз
+	static const size_t SPARSE_SEARCH_RATIO = 8;
+	using QueryWords = SmallVector<std::string_view, QUERY_INLINE_WORD_COUNT>;
+
 	struct QueryVector {
-		std::vector<std::string_view> plus_words;
-		std::vector<std::string_view> minus_words;
+		QueryWords plus_words;
+		QueryWords minus_words;
 	};
 
 	bool IsStopWord(std::string_view word) const;
@@ -120,61 +270,349 @@ private:
 
 	std::vector<std::string_view> SplitIntoWordsNoStop(std::string_view text) const;
 
+	// частоты слов документа; ключи ссылаются на text
+	std::map<std::string_view, double> ComputeWordFreqs(std::string_view text) const;
+
 	static int ComputeAverageRating(const std::vector<int>& ratings);
 
+	// на сколько частей делить порядковые номера документов при поиске
+	template <typename Execution>
+	size_t GetSearchPartCount(Execution&& policy) const;
+
+	// порядковый номер документа или -1, если документа нет
+	int FindOrdinal(int document_id) const;
+
+	// заводит порядковый номер и заполняет столбцы документа, слова добавляются отдельно
+	int AddDocumentData(int document_id, int rating, DocumentStatus status, std::string_view text);
+
+	// хеш набора номеров слов документа, частоты не учитываются
+	static uint64_t ComputeTermSetFingerprint(const ForwardIndex::Terms& terms);
+
+	// помечает документ удалённым: снимает его со счётчиков списков слов, статусов и id
+	void MarkDocumentRemoved(int ordinal);
+
+	// уплотнение нужно, когда удалённых номеров больше половины
+	bool IsCompactionNeeded() const {
+		return 2 * document_ids_.size() < ordinal_to_id_.size();
+	}
+
+	// старый порядковый номер -> новый: номера живых документов подряд с сохранением порядка, -1 для удалённых
+	std::vector<int> ComputeCompactOrdinals() const;
+
+	// переносит столбцы документов и прямой индекс на новые номера
+	void RemapDocumentData(const std::vector<int>& new_ordinals);
+
+	// порядок выдачи: по убыванию релевантности, при равной (в пределах EXP) - по убыванию рейтинга
+	static bool IsMoreRelevant(const Document& lhs, const Document& rhs);
+
+	// оставляет в documents max_count лучших документов в порядке выдачи, не сортируя весь вектор
+	template <typename Execution>
+	static void SelectTopDocuments(Execution&& policy, std::vector<Document>& documents, size_t max_count);
+
 	QueryWord ParseQueryWord(std::string_view text) const;
 	//для структуры Query
 	//Query ParseQuery(std::string_view text) const;
-	//для структуры QueryVector
+	//для структуры QueryVector, слова отсортированы и не повторяются
 	QueryVector ParseQueryVector(std::string_view text) const;
-	// Existence required
-	double ComputeWordInverseDocumentFreq(std::string_view word) const;
 
-	// FindAllDocuments - находит и возвращает все документы по запросу, соответствующие предикату
-    //1
+	static std::string MakeResultCacheKey(const QueryVector& query, DocumentStatus status, size_t max_count);
+
+	// scratch == nullptr - буферы выделяются на время запроса
+	template <typename Execution>
+	std::vector<Document> FindTopDocumentsByStatus(Execution&& policy, std::string_view raw_query,
+		DocumentStatus status, size_t max_count, QueryScratch* scratch = nullptr) const;
+
+	// проверка дедлайна в цикле поиска: часы читаются раз в CHECK_PERIOD шагов, без дедлайна - никогда
+	class DeadlineCheck {
+	public:
+		static const uint32_t CHECK_PERIOD = 1024;
+
+		explicit DeadlineCheck(const QueryScratch* scratch)
+			: deadline_(scratch ? scratch->deadline_ : std::chrono::steady_clock::time_point::max()) {
+		}
+
+		bool IsExpired() {
+			if (deadline_ == std::chrono::steady_clock::time_point::max() || --countdown_ > 0) {
+				return false;
+			}
+			countdown_ = CHECK_PERIOD;
+			return std::chrono::steady_clock::now() >= deadline_;
+		}
+
+	private:
+		std::chrono::steady_clock::time_point deadline_;
+		uint32_t countdown_ = 1;
+	};
+
+	// отбор по статусу: поиск проверяет его по множествам номеров статусов, не читая столбец статусов
+	struct StatusPredicate {
+		DocumentStatus status;
+		bool operator()(int, DocumentStatus document_status, int) const {
+			return document_status == status;
+		}
+	};
+
+	// допустимые документы части поиска: номер во множестве статуса (для прочих предикатов - не удалённые документы)
+	// и ни одного минус слова. Минус слова проверяются курсорами по их спискам, поэтому между Restart номера
+	// проверяются по возрастанию, а проверка стоит O(записей минус слов), а не O(документов части)
+	class PartFilter {
+	public:
+		PartFilter(const DocumentBitmap& documents, bool is_excluding,
+			const std::vector<const InvertedIndex::PostingList*>& minus_postings, int first)
+			: documents_(&documents)
+			, is_excluding_(is_excluding)
+			, minus_postings_(&minus_postings) {
+			minus_cursors_.reserve(minus_postings.size());
+			Restart(first);
+		}
+
+		// новый проход по возрастанию номеров с first
+		void Restart(int first) {
+			minus_cursors_.clear();
+			for (const auto postings : *minus_postings_) {
+				minus_cursors_.emplace_back(*postings);
+				minus_cursors_.back().SkipTo(first);
+			}
+		}
+
+		bool Test(int ordinal) {
+			if (documents_->Test(ordinal) == is_excluding_) {
+				return false;
+			}
+			for (auto& cursor : minus_cursors_) {
+				cursor.SkipTo(ordinal);
+				if (!cursor.AtEnd() && cursor.GetOrdinal() == ordinal) {
+					return false;
+				}
+			}
+			return true;
+		}
+
+	private:
+		const DocumentBitmap* documents_;
+		bool is_excluding_; // documents_ - исключённые документы, а не допустимые
+		const std::vector<const InvertedIndex::PostingList*>* minus_postings_;
+		std::vector<InvertedIndex::PostingList::Cursor> minus_cursors_;
+	};
+
+	// фильтр части, начинающейся с first, для статуса (для прочих предикатов - все документы) без минус слов
 	template <typename DocumentPredicate>
-	std::vector<Document> FindAllDocuments(const QueryVector& query,
-		DocumentPredicate document_predicate) const;
-	//2
+	PartFilter BuildPartFilter(const DocumentPredicate& document_predicate, int first,
+		const std::vector<const InvertedIndex::PostingList*>& minus_postings) const;
+
+	template <typename Execution, typename DocumentPredicate>
+	std::vector<Document> FindTopDocumentsForQuery(Execution&& policy, QueryVector& query,
+		DocumentPredicate document_predicate, size_t max_count, QueryScratch* scratch = nullptr) const;
+
+	// оставляет в documents max_count лучших документов запроса в порядке выдачи.
+	// со scratch векторы кандидатов частей берутся из него и сохраняют память между запросами
+	template <typename Execution, typename DocumentPredicate>
+	void CollectTopDocuments(Execution&& policy, QueryVector& query, DocumentPredicate document_predicate,
+		size_t max_count, QueryScratch* scratch, std::vector<Document>& documents) const;
+
+	// склеивает кандидатов частей в documents; единственная часть обменивается с documents без копирования
+	static void MergePartDocuments(std::vector<std::vector<Document>>& part_documents, std::vector<Document>& documents);
+	double ComputeWordInverseDocumentFreq(const InvertedIndex::PostingList& postings) const;
+
+	// FindTopCandidates - находит документы, которые могут войти в max_count лучших (MaxScore).
+	// Документ пропускается, если даже с наибольшими вкладами ещё не проверенных слов он хуже max_count уже найденных;
+	// лучшие max_count среди найденных совпадают с лучшими среди всех документов запроса
+	template <typename DocumentPredicate, typename Execution>
+	void FindTopCandidates(Execution&& policy, const QueryVector& query, DocumentPredicate document_predicate,
+		size_t max_count, const QueryScratch* scratch, std::vector<std::vector<Document>>& part_documents) const;
+
+	// FindAllDocuments - находит все документы по запросу, соответствующие предикату
+	// FindTopCandidates и FindAllDocuments складывают документы части i в part_documents[i]
 	template <typename DocumentPredicate, typename Execution>
-	std::vector<Document> FindAllDocuments(Execution&& policy,
-		QueryVector& query, DocumentPredicate document_predicate) const;
+	void FindAllDocuments(Execution&& policy, QueryVector& query, DocumentPredicate document_predicate,
+		QueryScratch* scratch, std::vector<std::vector<Document>>& part_documents) const;
 };
 
 template<class Execution>
 void SearchServer::RemoveDocument(Execution&& policy, int document_id)
 {
-	const auto it_word = document_to_word_.find(document_id);
-	if (it_word == document_to_word_.end())
+	const int ordinal = FindOrdinal(document_id);
+	if (ordinal < 0)
+		return;
+	MarkDocumentRemoved(ordinal);
+	if (IsCompactionNeeded()) {
+		Compact(policy);
+	}
+}
+
+template<class Execution>
+void SearchServer::RemoveDocuments(Execution&& policy, const std::vector<int>& document_ids)
+{
+	for (const int document_id : document_ids) {
+		const int ordinal = FindOrdinal(document_id);
+		if (ordinal >= 0) {
+			MarkDocumentRemoved(ordinal);
+		}
+	}
+	if (IsCompactionNeeded()) {
+		Compact(policy);
+	}
+}
+
+template<class Execution>
+std::vector<int> SearchServer::RemoveDuplicates(Execution&& policy)
+{
+	struct Fingerprint {
+		uint64_t hash;
+		int document_id;
+		int ordinal;
+	};
+	std::vector<Fingerprint> fingerprints;
+	fingerprints.reserve(document_ids_.size());
+	for (size_t ordinal = 0; ordinal < ordinal_to_id_.size(); ++ordinal) {
+		if (ordinal_to_id_[ordinal] >= 0) {
+			fingerprints.push_back({ 0, ordinal_to_id_[ordinal], static_cast<int>(ordinal) });
+		}
+	}
+	std::for_each(policy, fingerprints.begin(), fingerprints.end(), [this](Fingerprint& fingerprint) {
+		fingerprint.hash = ComputeTermSetFingerprint(ordinal_to_terms_.Get(fingerprint.ordinal));
+	});
+	// одинаковые хеши оказываются рядом, в группе первым идёт меньший id
+	std::sort(policy, fingerprints.begin(), fingerprints.end(), [](const Fingerprint& lhs, const Fingerprint& rhs) {
+		return std::tie(lhs.hash, lhs.document_id) < std::tie(rhs.hash, rhs.document_id);
+	});
+
+	const auto is_same_term_set = [this](int lhs_ordinal, int rhs_ordinal) {
+		const ForwardIndex::Terms lhs = ordinal_to_terms_.Get(lhs_ordinal);
+		const ForwardIndex::Terms rhs = ordinal_to_terms_.Get(rhs_ordinal);
+		return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(), [](const auto& lhs_term, const auto& rhs_term) {
+			return lhs_term.term_id == rhs_term.term_id;
+		});
+	};
+	std::vector<int> duplicate_ids;
+	// оставленные документы группы с одинаковым хешем; при совпадении хешей разных наборов их будет несколько
+	std::vector<int> kept_ordinals;
+	for (size_t i = 0; i < fingerprints.size(); ++i) {
+		if (i == 0 || fingerprints[i].hash != fingerprints[i - 1].hash) {
+			kept_ordinals.clear();
+		}
+		const int ordinal = fingerprints[i].ordinal;
+		if (std::any_of(kept_ordinals.begin(), kept_ordinals.end(), [&](int kept_ordinal) {
+			return is_same_term_set(kept_ordinal, ordinal);
+		})) {
+			duplicate_ids.push_back(fingerprints[i].document_id);
+		}
+		else {
+			kept_ordinals.push_back(ordinal);
+		}
+	}
+	std::sort(duplicate_ids.begin(), duplicate_ids.end());
+	RemoveDocuments(policy, duplicate_ids);
+	return duplicate_ids;
+}
+
+template<class Execution>
+void SearchServer::Compact(Execution&& policy)
+{
+	if (ordinal_to_id_.size() == document_ids_.size()) {
 		return;
+	}
+	const std::vector<int> new_ordinals = ComputeCompactOrdinals();
+	word_to_document_.RemapOrdinals(policy, new_ordinals);
+	RemapDocumentData(new_ordinals);
+}
+
+template <typename Execution>
+void SearchServer::AddDocuments(Execution&& policy, const std::vector<RawDocument>& documents)
+{
+	std::set<int> batch_ids;
+	for (const RawDocument& document : documents) {
+		if ((document.id < 0) || (id_to_ordinal_.count(document.id) > 0) || !batch_ids.insert(document.id).second) {
+			throw std::invalid_argument("Invalid document_id"s);
+		}
+	}
+
+	// разбиение на слова и подсчёт частот - параллельно, исключения собираются и выбрасываются после
+	std::vector<std::map<std::string_view, double>> word_freqs(documents.size());
+	std::vector<std::exception_ptr> errors(documents.size());
+	std::vector<size_t> indexes(documents.size());
+	std::iota(indexes.begin(), indexes.end(), 0);
+	std::for_each(policy,
+		indexes.begin(), indexes.end(),
+		[&](size_t index) {
+		try {
+			word_freqs[index] = ComputeWordFreqs(documents[index].text);
+		}
+		catch (...) {
+			errors[index] = std::current_exception();
+		}
+	});
+	for (const auto& error : errors) {
+		if (error) {
+			std::rethrow_exception(error);
+		}
+	}
 
-	// формирование вектора слов документа
-	std::vector<std::string_view> words(document_to_word_.at(document_id).size());
+	++generation_;
+	const int first_ordinal = static_cast<int>(ordinal_to_id_.size());
+	for (const RawDocument& document : documents) {
+		AddDocumentData(document.id, ComputeAverageRating(document.ratings), document.status, document.text);
+	}
 
-	std::transform(
-		it_word->second.begin(),
-		it_word->second.end(),
-		std::back_inserter(words),
-		[](auto &word) { return word.first; });
+	// пары (документ, частота) раскладываются по словам параллельно в ConcurrentMap. Затем слова пакета
+	// по возрастанию заводятся в словаре, каждое один раз, а списки разных слов дополняются параллельно
+	struct BatchPosting {
+		int ordinal;
+		double term_freq;
+		InvertedIndex::FreqCode freq_code;
+	};
+	ConcurrentMap<std::string_view, std::vector<BatchPosting>> word_postings(STREAM_MAX);
+	std::for_each(policy,
+		indexes.begin(), indexes.end(),
+		[&](size_t index) {
+		const int ordinal = first_ordinal + static_cast<int>(index);
+		for (const auto&[word, term_freq] : word_freqs[index]) {
+			word_postings[word].ref_to_value.push_back({ ordinal, term_freq, 0 });
+		}
+	});
+	std::map<std::string_view, std::vector<BatchPosting>> batch_terms = word_postings.BuildOrdinaryMap();
 
+	std::vector<std::pair<InvertedIndex::TermId, std::vector<BatchPosting>*>> groups;
+	groups.reserve(batch_terms.size());
+	for (auto&[word, group_postings] : batch_terms) {
+		groups.emplace_back(word_to_document_.AddTerm(word), &group_postings);
+		for (BatchPosting& posting : group_postings) {
+			posting.freq_code = word_to_document_.AddTermFreq(posting.term_freq);
+		}
+	}
+	std::for_each(policy,
+		groups.begin(), groups.end(),
+		[&](const auto& group) {
+		// документы одного слова приходят из разных потоков вперемешку
+		std::sort(group.second->begin(), group.second->end(), [](const BatchPosting& lhs, const BatchPosting& rhs) {
+			return lhs.ordinal < rhs.ordinal;
+		});
+		for (const BatchPosting& posting : *group.second) {
+			word_to_document_.AddPosting(group.first, posting.ordinal, posting.freq_code);
+		}
+	});
 
+	// прямой индекс: частоты слов документов по номерам слов
+	ordinal_to_terms_.resize(ordinal_to_id_.size());
 	std::for_each(policy,
-		words.begin(), words.end(),
-		[&](auto &word) {
-		const auto it = word_to_document_.find(word);
-		if (it != word_to_document_.end()) {
-			it->second.erase(document_id);
+		indexes.begin(), indexes.end(),
+		[&](size_t index) {
+		TermFreqs& terms = ordinal_to_terms_.Edit(first_ordinal + static_cast<int>(index));
+		terms.reserve(word_freqs[index].size());
+		for (const auto&[word, term_freq] : word_freqs[index]) {
+			terms.push_back({ word_to_document_.FindTermId(word), word_to_document_.FindTermFreq(term_freq) });
 		}
+		std::sort(terms.begin(), terms.end());
 	});
-	//удаляем в оставшихся словарях
-	document_to_word_.erase(document_id);
-	documents_.erase(document_id);
-	document_ids_.erase(document_id);
 }
 
 template <typename StringContainer>
-SearchServer::SearchServer(const StringContainer& stop_words)
+SearchServer::SearchServer(const StringContainer& stop_words, std::pmr::memory_resource* resource)
 	: stop_words_(MakeUniqueNonEmptyStrings(stop_words))  // Extract non-empty stop words
+	, stop_word_lookup_(stop_words_.begin(), stop_words_.end())
+	, word_to_document_(resource)
+	, ordinal_to_terms_(resource)
+	, id_to_ordinal_(resource)
 {
 	if (!std::all_of(stop_words_.begin(), stop_words_.end(), IsValidWord)) {
 		throw std::invalid_argument("Some of stop words are invalid");
@@ -183,141 +621,420 @@ SearchServer::SearchServer(const StringContainer& stop_words)
 
 template <typename DocumentPredicate>
 std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query,
-	DocumentPredicate document_predicate) const
+	DocumentPredicate document_predicate, size_t max_count) const
 {
-    auto query = ParseQueryVector(raw_query);
-	auto matched_documents = FindAllDocuments(std::execution::seq, query, document_predicate);
-
-	sort(matched_documents.begin(), matched_documents.end(),
-		[](const Document& lhs, const Document& rhs) {
-		if (std::abs(lhs.relevance - rhs.relevance) < EXP) {
-			return lhs.rating > rhs.rating;
-		}
-		else {
-			return lhs.relevance > rhs.relevance;
-		}
-	});
-
-	if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
-		matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
-	}
-	return matched_documents;
+	auto query = ParseQueryVector(raw_query);
+	return FindTopDocumentsForQuery(std::execution::seq, query, document_predicate, max_count);
 }
 //2
 template <typename Execution, typename DocumentPredicate>
 std::vector<Document> SearchServer::FindTopDocuments(Execution&& policy,
-	std::string_view raw_query, DocumentPredicate document_predicate) const
+	std::string_view raw_query, DocumentPredicate document_predicate, size_t max_count) const
 {
 	auto query = ParseQueryVector(raw_query);
-	auto matched_documents = FindAllDocuments(policy, query, document_predicate);
-
-	sort(policy,
-		matched_documents.begin(), matched_documents.end(),
-		[](const Document& lhs, const Document& rhs) {
-		if (std::abs(lhs.relevance - rhs.relevance) < EXP) {
-			return lhs.rating > rhs.rating;
-		}
-		else {
-			return lhs.relevance > rhs.relevance;
-		}
-	});
+	return FindTopDocumentsForQuery(policy, query, document_predicate, max_count);
+}
 
-	if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
-		matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
+template <typename Execution>
+std::vector<Document> SearchServer::FindTopDocumentsByStatus(Execution&& policy, std::string_view raw_query,
+	DocumentStatus status, size_t max_count, QueryScratch* scratch) const
+{
+	auto query = ParseQueryVector(raw_query);
+	const StatusPredicate document_predicate{ status };
+	if (!result_cache_) {
+		return FindTopDocumentsForQuery(policy, query, document_predicate, max_count, scratch);
 	}
+	const std::string key = MakeResultCacheKey(query, status, max_count);
+	if (auto cached_documents = result_cache_->Find(key, generation_)) {
+		return std::move(*cached_documents);
+	}
+	auto matched_documents = FindTopDocumentsForQuery(policy, query, document_predicate, max_count, scratch);
+	result_cache_->Insert(key, generation_, matched_documents);
 	return matched_documents;
 }
 
-template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindAllDocuments(const QueryVector& query, DocumentPredicate document_predicate) const
+template <typename Execution>
+size_t SearchServer::FindTopDocuments(Execution&& policy, QueryScratch& scratch, std::string_view raw_query,
+	Document* output, DocumentStatus status, size_t max_count) const
 {
+	auto query = ParseQueryVector(raw_query);
+	const StatusPredicate document_predicate{ status };
+	std::string key;
+	if (result_cache_) {
+		key = MakeResultCacheKey(query, status, max_count);
+		if (const auto cached_documents = result_cache_->Find(key, generation_)) {
+			return std::copy(cached_documents->begin(), cached_documents->end(), output) - output;
+		}
+	}
+	std::vector<Document>& documents = scratch.candidates_;
+	CollectTopDocuments(policy, query, document_predicate, max_count, &scratch, documents);
+	if (result_cache_) {
+		result_cache_->Insert(key, generation_, documents);
+	}
+	return std::copy(documents.begin(), documents.end(), output) - output;
+}
 
-	std::map<int, double> document_to_relevance;
-	//плюс слова
-	for (std::string_view word : query.plus_words) {
+template <typename Execution, typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocumentsForQuery(Execution&& policy, QueryVector& query,
+	DocumentPredicate document_predicate, size_t max_count, QueryScratch* scratch) const
+{
+	std::vector<Document> matched_documents;
+	CollectTopDocuments(policy, query, document_predicate, max_count, scratch, matched_documents);
+	return matched_documents;
+}
 
-		if (word_to_document_.count((word)) != 0) {
-			const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-			for (const auto[document_id, term_freq] : word_to_document_.at((word))) {
-				const auto& document_data = documents_.at(document_id);
-				if (document_predicate(document_id, document_data.status, document_data.rating)) {
-					document_to_relevance[document_id] += term_freq * inverse_document_freq;
-				}
-			}
-		}
+template <typename Execution, typename DocumentPredicate>
+void SearchServer::CollectTopDocuments(Execution&& policy, QueryVector& query, DocumentPredicate document_predicate,
+	size_t max_count, QueryScratch* scratch, std::vector<Document>& documents) const
+{
+	std::vector<std::vector<Document>> local_part_documents;
+	std::vector<std::vector<Document>>& part_documents = scratch ? scratch->part_documents_ : local_part_documents;
+	// для одного слова отсекать нечего - полный перебор с накопителем быстрее
+	if (max_count > 0 && query.plus_words.size() > 1) {
+		FindTopCandidates(policy, query, document_predicate, max_count, scratch, part_documents);
 	}
-	//минус слова 
-	for (std::string_view word : query.minus_words) {
-		if (word_to_document_.count(word) != 0) {
-			for (const auto[document_id, _] : word_to_document_.at(word)) {
-				document_to_relevance.erase(document_id);
+	else {
+		FindAllDocuments(policy, query, document_predicate, scratch, part_documents);
+	}
+	MergePartDocuments(part_documents, documents);
+	SelectTopDocuments(policy, documents, max_count);
+}
+
+template <typename Execution>
+void SearchServer::SelectTopDocuments(Execution&& policy, std::vector<Document>& documents, size_t max_count)
+{
+	if (documents.size() <= max_count) {
+		std::sort(policy, documents.begin(), documents.end(), IsMoreRelevant);
+		return;
+	}
+	auto candidates_end = documents.end();
+	if constexpr (!std::is_same_v<std::decay_t<Execution>, std::execution::sequenced_policy>) {
+		// каждый поток отбирает лучшие max_count документов своей части,
+		// затем кандидаты всех частей собираются в начале вектора
+		const size_t part_count = std::min<size_t>(STREAM_MAX, documents.size() / (4 * max_count + 1));
+		if (part_count > 1) {
+			const size_t part_size = (documents.size() + part_count - 1) / part_count;
+			std::vector<size_t> parts(part_count);
+			std::iota(parts.begin(), parts.end(), 0);
+			std::for_each(policy, parts.begin(), parts.end(), [&](size_t part) {
+				const auto part_begin = documents.begin() + std::min(documents.size(), part * part_size);
+				const auto part_end = documents.begin() + std::min(documents.size(), (part + 1) * part_size);
+				const auto top_end = part_begin + std::min<size_t>(max_count, part_end - part_begin);
+				std::partial_sort(part_begin, top_end, part_end, IsMoreRelevant);
+			});
+			candidates_end = documents.begin();
+			for (size_t part = 0; part < part_count; ++part) {
+				const auto part_begin = documents.begin() + std::min(documents.size(), part * part_size);
+				const auto part_end = documents.begin() + std::min(documents.size(), (part + 1) * part_size);
+				const auto top_end = part_begin + std::min<size_t>(max_count, part_end - part_begin);
+				candidates_end = (candidates_end == part_begin) ? top_end
+					: std::move(part_begin, top_end, candidates_end);
 			}
 		}
 	}
-	// вектор совпадения документов
-	std::vector<Document> matched_documents;
-	matched_documents.reserve(document_to_relevance.size());
-	for (const auto&[document_id, relevance] : document_to_relevance) {
-		matched_documents.push_back({ document_id, relevance, documents_.at(document_id).rating });
-	}
+	const auto top_end = documents.begin() + std::min<size_t>(max_count, candidates_end - documents.begin());
+	std::partial_sort(documents.begin(), top_end, candidates_end, IsMoreRelevant);
+	documents.erase(top_end, documents.end());
+}
 
-	return matched_documents;
+template <typename Execution>
+size_t SearchServer::GetSearchPartCount(Execution&&) const
+{
+	if constexpr (std::is_same_v<std::decay_t<Execution>, std::execution::sequenced_policy>) {
+		return 1;
+	}
+	else {
+		// мелкие части не окупают запуск потока
+		const size_t thread_count = std::max(std::thread::hardware_concurrency(), 1u);
+		return std::min(thread_count, ordinal_to_id_.size() / 1024 + 1);
+	}
 }
 
 template <typename DocumentPredicate, typename Execution>
-std::vector<Document> SearchServer::FindAllDocuments(Execution&& policy,
-	QueryVector& query, DocumentPredicate document_predicate) const
+void SearchServer::FindTopCandidates(Execution&& policy, const QueryVector& query, DocumentPredicate document_predicate,
+	size_t max_count, const QueryScratch* scratch, std::vector<std::vector<Document>>& part_documents) const
 {
-	ConcurrentMap<int, double> document_to_relevance(STREAM_MAX);
+	struct QueryTerm {
+		const InvertedIndex::PostingList* postings;
+		double inverse_document_freq;
+		double max_relevance; // наибольший вклад слова в релевантность документа
+		size_t index;         // номер слова в запросе - вклады складываются в этом порядке, как при полном переборе
+	};
+	std::vector<QueryTerm> plus_terms;
+	plus_terms.reserve(query.plus_words.size());
+	for (std::string_view word : query.plus_words) {
+		const InvertedIndex::TermId term_id = word_to_document_.FindTermId(word);
+		if (term_id == InvertedIndex::NO_TERM || word_to_document_.GetPostings(term_id).empty()) {
+			continue;
+		}
+		const auto& postings = word_to_document_.GetPostings(term_id);
+		const double inverse_document_freq = ComputeWordInverseDocumentFreq(postings);
+		plus_terms.push_back({ &postings, inverse_document_freq,
+			word_to_document_.GetMaxTermFreq(term_id) * inverse_document_freq, plus_terms.size() });
+	}
+	std::vector<const InvertedIndex::PostingList*> minus_postings;
+	minus_postings.reserve(query.minus_words.size());
+	for (std::string_view word : query.minus_words) {
+		if (const auto postings = word_to_document_.Find(word)) {
+			minus_postings.push_back(postings);
+		}
+	}
+
+	// слова по возрастанию наибольшего вклада; bounds[i] - сумма наибольших вкладов слов [0, i]
+	std::sort(plus_terms.begin(), plus_terms.end(), [](const QueryTerm& lhs, const QueryTerm& rhs) {
+		return lhs.max_relevance < rhs.max_relevance;
+	});
+	std::vector<double> bounds(plus_terms.size());
+	double bound = 0.0;
+	for (size_t i = 0; i < plus_terms.size(); ++i) {
+		bound += plus_terms[i].max_relevance;
+		bounds[i] = bound;
+	}
+	// запас больше погрешности сумм: документ, отставший меньше чем на EXP, может обогнать по рейтингу
+	const double margin = 2 * EXP;
 
-	//сортируем и упорядочеваем к выдаче + слова
-	if (!query.plus_words.empty())
-	{
-		std::sort(policy, query.plus_words.begin(), query.plus_words.end());
-		const auto range_end = std::unique(std::execution::par, query.plus_words.begin(), query.plus_words.end());
-		query.plus_words.erase(range_end, query.plus_words.end());
+	// части порядковых номеров независимы: в каждой свои max_count лучших и свой порог
+	const size_t part_count = GetSearchPartCount(policy);
+	const size_t part_size = RelevanceAccumulator::GetPartSize(ordinal_to_id_.size(), part_count);
+	part_documents.resize(part_count);
+	for (auto& documents : part_documents) {
+		documents.clear();
 	}
+	std::vector<size_t> parts(part_count);
+	std::iota(parts.begin(), parts.end(), 0);
+	// исключение из параллельного алгоритма завершило бы программу, поэтому части только останавливаются
+	std::atomic<bool> is_expired = false;
 
 	std::for_each(policy,
-		query.plus_words.begin(), query.plus_words.end(),
-		[this, &document_to_relevance, document_predicate](auto &word) {
-		// проходим по всем документам содержащим плюс слова
-		if (word_to_document_.count(word) != 0) {
-			const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-			for (const auto[document_id, term_freq] : word_to_document_.at(word)) {
-				const auto& document_data = documents_.at(document_id);
-				if (document_predicate(document_id, document_data.status, document_data.rating)) {
-					document_to_relevance[document_id].ref_to_value += term_freq * inverse_document_freq;
+		parts.begin(), parts.end(),
+		[&](size_t part) {
+		DeadlineCheck deadline_check(scratch);
+		const int first = static_cast<int>(std::min(ordinal_to_id_.size(), part * part_size));
+		const int last = static_cast<int>(std::min(ordinal_to_id_.size(), (part + 1) * part_size));
+		std::vector<InvertedIndex::PostingList::Cursor> plus_cursors;
+		plus_cursors.reserve(plus_terms.size());
+		for (const QueryTerm& term : plus_terms) {
+			plus_cursors.emplace_back(*term.postings);
+			plus_cursors.back().SkipTo(first);
+		}
+		PartFilter filter = BuildPartFilter(document_predicate, first, minus_postings);
+		std::vector<double> relevances(plus_terms.size());
+		std::vector<char> matched(plus_terms.size());
+		// наименьшая из max_count лучших релевантностей части - порог
+		std::priority_queue<double, std::vector<double>, std::greater<double>> top_relevances;
+		double threshold = -std::numeric_limits<double>::infinity();
+		// слова [0, essential) вместе не набирают порога: документы, где есть только они, не рассматриваются
+		size_t essential = 0;
+
+		while (true) {
+			int ordinal = last;
+			for (size_t i = essential; i < plus_cursors.size(); ++i) {
+				if (!plus_cursors[i].AtEnd()) {
+					ordinal = std::min(ordinal, plus_cursors[i].GetOrdinal());
+				}
+			}
+			if (ordinal >= last) {
+				break;
+			}
+			if (deadline_check.IsExpired()) {
+				is_expired = true;
+				break;
+			}
+			if (!filter.Test(ordinal)) {
+				for (size_t i = essential; i < plus_cursors.size(); ++i) {
+					if (!plus_cursors[i].AtEnd() && plus_cursors[i].GetOrdinal() == ordinal) {
+						plus_cursors[i].Next();
+					}
+				}
+				continue;
+			}
+
+			std::fill(matched.begin(), matched.end(), 0);
+			double score = 0.0;
+			for (size_t i = essential; i < plus_cursors.size(); ++i) {
+				auto& cursor = plus_cursors[i];
+				if (!cursor.AtEnd() && cursor.GetOrdinal() == ordinal) {
+					const QueryTerm& term = plus_terms[i];
+					relevances[term.index] = word_to_document_.GetTermFreq(cursor.GetFreqCode()) * term.inverse_document_freq;
+					matched[term.index] = 1;
+					score += relevances[term.index];
+					cursor.Next();
+				}
+			}
+			// необязательные слова проверяются от большего вклада к меньшему, пока документ может набрать порог
+			bool is_pruned = false;
+			for (size_t i = essential; i-- > 0;) {
+				if (score + bounds[i] + margin < threshold) {
+					is_pruned = true;
+					break;
+				}
+				auto& cursor = plus_cursors[i];
+				cursor.SkipTo(ordinal);
+				if (!cursor.AtEnd() && cursor.GetOrdinal() == ordinal) {
+					const QueryTerm& term = plus_terms[i];
+					relevances[term.index] = word_to_document_.GetTermFreq(cursor.GetFreqCode()) * term.inverse_document_freq;
+					matched[term.index] = 1;
+					score += relevances[term.index];
+				}
+			}
+			if (is_pruned || score + margin < threshold) {
+				continue;
+			}
+			const int document_id = ordinal_to_id_[ordinal];
+			if constexpr (!std::is_same_v<DocumentPredicate, StatusPredicate>) {
+				if (!document_predicate(document_id, statuses_[ordinal], ratings_[ordinal])) {
+					continue;
+				}
+			}
+
+			double relevance = 0.0;
+			for (size_t index = 0; index < relevances.size(); ++index) {
+				if (matched[index]) {
+					relevance += relevances[index];
+				}
+			}
+			part_documents[part].push_back({ document_id, relevance, ratings_[ordinal] });
+			top_relevances.push(relevance);
+			if (top_relevances.size() > max_count) {
+				top_relevances.pop();
+			}
+			if (top_relevances.size() == max_count) {
+				threshold = top_relevances.top();
+				while (essential < bounds.size() && bounds[essential] + margin < threshold) {
+					++essential;
 				}
 			}
 		}
 	});
 
-	std::map<int, double> document_relevance = document_to_relevance.BuildOrdinaryMap();
-	//сортируем и упорядочеваем к выдаче - слова
-	if (!query.minus_words.empty())
-	{
-		std::sort(policy, query.minus_words.begin(), query.minus_words.end());
-		const auto range_end = std::unique(policy, query.minus_words.begin(), query.minus_words.end());
-		query.minus_words.erase(range_end, query.minus_words.end());
+	if (is_expired) {
+		throw QueryDeadlineExceeded();
+	}
+}
+
+template <typename DocumentPredicate>
+SearchServer::PartFilter SearchServer::BuildPartFilter(const DocumentPredicate& document_predicate, int first,
+	const std::vector<const InvertedIndex::PostingList*>& minus_postings) const
+{
+	if constexpr (std::is_same_v<DocumentPredicate, StatusPredicate>) {
+		return PartFilter(status_to_documents_[static_cast<size_t>(document_predicate.status)], false, minus_postings, first);
+	}
+	else {
+		// в списках ещё могут быть записи удалённых документов
+		return PartFilter(removed_documents_, true, minus_postings, first);
+	}
+}
+
+template <typename DocumentPredicate, typename Execution>
+void SearchServer::FindAllDocuments(Execution&& policy, QueryVector& query, DocumentPredicate document_predicate,
+	QueryScratch* scratch, std::vector<std::vector<Document>>& part_documents) const
+{
+	// списки документов и idf слов запроса находим один раз для всех частей
+	std::vector<std::pair<const InvertedIndex::PostingList*, double>> plus_postings;
+	plus_postings.reserve(query.plus_words.size());
+	for (std::string_view word : query.plus_words) {
+		if (const auto postings = word_to_document_.Find(word)) {
+			plus_postings.emplace_back(postings, ComputeWordInverseDocumentFreq(*postings));
+		}
+	}
+	std::vector<const InvertedIndex::PostingList*> minus_postings;
+	minus_postings.reserve(query.minus_words.size());
+	for (std::string_view word : query.minus_words) {
+		if (const auto postings = word_to_document_.Find(word)) {
+			minus_postings.push_back(postings);
+		}
+	}
+
+	// когда записей в списках слов намного меньше, чем документов, вклады собираются в вектор и сортируются:
+	// это дешевле случайного доступа к накопителю, а без scratch - ещё и его выделения, O(документов)
+	size_t posting_count = 0;
+	for (const auto&[postings, inverse_document_freq] : plus_postings) {
+		posting_count += postings->size();
+	}
+	const bool is_sparse = posting_count * SPARSE_SEARCH_RATIO < ordinal_to_id_.size();
+
+	// каждая часть порядковых номеров обрабатывается одним потоком от начала до конца
+	const size_t part_count = GetSearchPartCount(policy);
+	const size_t part_size = RelevanceAccumulator::GetPartSize(ordinal_to_id_.size(), part_count);
+	RelevanceAccumulator local_accumulator;
+	RelevanceAccumulator& accumulator = scratch ? scratch->accumulator_ : local_accumulator;
+	if (!is_sparse) {
+		accumulator.Reset(ordinal_to_id_.size(), part_count);
+	}
+	part_documents.resize(part_count);
+	for (auto& documents : part_documents) {
+		documents.clear();
 	}
+	std::vector<size_t> parts(part_count);
+	std::iota(parts.begin(), parts.end(), 0);
+	std::atomic<bool> is_expired = false;
 
 	std::for_each(policy,
-		query.minus_words.begin(), query.minus_words.end(),
-		[this, &document_relevance](auto &word) {
-		if (word_to_document_.count(word) != 0) {
-			for (const auto[document_id, _] : word_to_document_.at(word)) {
-				document_relevance.erase(document_id);
+		parts.begin(), parts.end(),
+		[&](size_t part) {
+		DeadlineCheck deadline_check(scratch);
+		const int first = static_cast<int>(std::min(ordinal_to_id_.size(), part * part_size));
+		const int last = static_cast<int>(std::min(ordinal_to_id_.size(), (part + 1) * part_size));
+		// статус и минус слова проверяются до подсчёта релевантности
+		PartFilter filter = BuildPartFilter(document_predicate, first, minus_postings);
+		// передаёт action вклады документов части по словам запроса; false - не уложились в дедлайн
+		const auto for_each_contribution = [&](auto action) {
+			for (const auto&[postings, inverse_document_freq] : plus_postings) {
+				filter.Restart(first);
+				InvertedIndex::PostingList::Cursor cursor(*postings);
+				for (cursor.SkipTo(first); !cursor.AtEnd() && cursor.GetOrdinal() < last; cursor.Next()) {
+					if (deadline_check.IsExpired()) {
+						return false;
+					}
+					const int ordinal = cursor.GetOrdinal();
+					if (!filter.Test(ordinal)) {
+						continue;
+					}
+					if constexpr (!std::is_same_v<DocumentPredicate, StatusPredicate>) {
+						if (!document_predicate(ordinal_to_id_[ordinal], statuses_[ordinal], ratings_[ordinal])) {
+							continue;
+						}
+					}
+					action(ordinal, word_to_document_.GetTermFreq(cursor.GetFreqCode()) * inverse_document_freq);
+				}
+			}
+			return true;
+		};
+
+		std::vector<Document>& documents = part_documents[part];
+		if (is_sparse) {
+			std::vector<std::pair<int, double>> contributions;
+			if (!for_each_contribution([&](int ordinal, double relevance) { contributions.emplace_back(ordinal, relevance); })) {
+				is_expired = true;
+				return;
+			}
+			// вклады документа остаются в порядке слов запроса, поэтому суммы те же, что в накопителе
+			if (plus_postings.size() > 1) {
+				std::stable_sort(contributions.begin(), contributions.end(), [](const auto& lhs, const auto& rhs) {
+					return lhs.first < rhs.first;
+				});
+			}
+			for (size_t i = 0; i < contributions.size();) {
+				const int ordinal = contributions[i].first;
+				double relevance = 0.0;
+				for (; i < contributions.size() && contributions[i].first == ordinal; ++i) {
+					relevance += contributions[i].second;
+				}
+				documents.push_back({ ordinal_to_id_[ordinal], relevance, ratings_[ordinal] });
 			}
 		}
+		else {
+			if (!for_each_contribution([&](int ordinal, double relevance) { accumulator.Add(part, ordinal, relevance); })) {
+				is_expired = true;
+				return;
+			}
+			accumulator.ExtractMatched(part, [&](int ordinal, double relevance) {
+				documents.push_back({ ordinal_to_id_[ordinal], relevance, ratings_[ordinal] });
+			});
+		}
 	});
 
-	std::vector<Document> matched_documents;
-	matched_documents.reserve(document_relevance.size());
-
-	for (const auto&[document_id, relevance] : document_relevance) {
-		matched_documents.push_back({ document_id, relevance, documents_.at(document_id).rating });
+	if (is_expired) {
+		throw QueryDeadlineExceeded();
 	}
-
-	return matched_documents;
-}
\ No newline at end of file
+}
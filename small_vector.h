@@ -0,0 +1,119 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+
+// Вектор с местом под N элементов внутри объекта: пока элементов не больше N, память в куче не выделяется.
+// Только для тривиально копируемых типов (string_view, числа), итераторы - обычные указатели.
+template <typename T, size_t N>
+class SmallVector {
+	static_assert(std::is_trivially_copyable_v<T>, "SmallVector supports only trivially copyable types");
+public:
+	SmallVector() = default;
+
+	SmallVector(const SmallVector& other) {
+		*this = other;
+	}
+
+	SmallVector(SmallVector&& other) noexcept {
+		*this = std::move(other);
+	}
+
+	SmallVector& operator=(const SmallVector& other) {
+		if (this != &other) {
+			clear();
+			reserve(other.size_);
+			std::copy(other.begin(), other.end(), data());
+			size_ = other.size_;
+		}
+		return *this;
+	}
+
+	SmallVector& operator=(SmallVector&& other) noexcept {
+		if (this == &other) {
+			return *this;
+		}
+		if (other.heap_) {
+			heap_ = std::move(other.heap_);
+			capacity_ = other.capacity_;
+		}
+		else {
+			heap_.reset();
+			capacity_ = N;
+			std::copy(other.begin(), other.end(), inline_);
+		}
+		size_ = other.size_;
+		other.size_ = 0;
+		other.capacity_ = N;
+		return *this;
+	}
+
+	T* data() {
+		return heap_ ? heap_.get() : inline_;
+	}
+	const T* data() const {
+		return heap_ ? heap_.get() : inline_;
+	}
+
+	T* begin() {
+		return data();
+	}
+	T* end() {
+		return data() + size_;
+	}
+	const T* begin() const {
+		return data();
+	}
+	const T* end() const {
+		return data() + size_;
+	}
+
+	size_t size() const {
+		return size_;
+	}
+	bool empty() const {
+		return size_ == 0;
+	}
+
+	T& operator[](size_t index) {
+		return data()[index];
+	}
+	const T& operator[](size_t index) const {
+		return data()[index];
+	}
+
+	void reserve(size_t capacity) {
+		if (capacity <= capacity_) {
+			return;
+		}
+		auto heap = std::make_unique<T[]>(capacity);
+		std::copy(begin(), end(), heap.get());
+		heap_ = std::move(heap);
+		capacity_ = capacity;
+	}
+
+	void push_back(const T& value) {
+		if (size_ == capacity_) {
+			reserve(capacity_ * 2);
+		}
+		data()[size_++] = value;
+	}
+
+	// удаляет [first, end()), как erase(unique(...), end()) у std::vector
+	void erase(T* first, T* last) {
+		const T* old_end = end();
+		T* new_end = std::copy(last, end(), first);
+		size_ -= old_end - new_end;
+	}
+
+	void clear() {
+		size_ = 0;
+	}
+
+private:
+	T inline_[N] = {};
+	std::unique_ptr<T[]> heap_;
+	size_t size_ = 0;
+	size_t capacity_ = N;
+};
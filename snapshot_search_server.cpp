@@ -0,0 +1,117 @@
+#include "snapshot_search_server.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+using namespace std;
+
+void SnapshotSearchServer::AddDocument(int document_id, std::string_view document,
+	DocumentStatus status, const std::vector<int>& ratings)
+{
+	lock_guard guard(writer_mutex_);
+	// если документ некорректен, исключение вылетит до записи изменения
+	if (TryReclaimWorking()) {
+		working_->AddDocument(document_id, document, status, ratings);
+	}
+	else {
+		CheckAddDocument(document_id, document);
+	}
+	RecordChange({ false, document_id, string(document), status, ratings });
+}
+
+void SnapshotSearchServer::RemoveDocument(int document_id)
+{
+	lock_guard guard(writer_mutex_);
+	if (TryReclaimWorking()) {
+		working_->RemoveDocument(document_id);
+	}
+	RecordChange({ true, document_id, {}, DocumentStatus::ACTUAL, {} });
+}
+
+bool SnapshotSearchServer::Publish()
+{
+	lock_guard guard(writer_mutex_);
+	if (!TryReclaimWorking()) {
+		return false;
+	}
+	if (unpublished_changes_.empty()) {
+		return true;
+	}
+	shared_ptr<ReleaseSlot> slot;
+	auto old_published = atomic_exchange(&published_, MakePublished(move(working_), slot));
+	retired_slot_ = exchange(published_slot_, move(slot));
+	// старому экземпляру не хватает ровно того, что сейчас опубликовано
+	working_backlog_ = move(unpublished_changes_);
+	unpublished_changes_.clear();
+
+	// если читателей у старого экземпляра нет, он вернётся в слот прямо здесь
+	old_published.reset();
+	TryReclaimWorking();
+	return true;
+}
+
+std::shared_ptr<const SearchServer> SnapshotSearchServer::MakePublished(std::unique_ptr<SearchServer> search_server,
+	std::shared_ptr<ReleaseSlot>& slot)
+{
+	slot = make_shared<ReleaseSlot>();
+	return shared_ptr<const SearchServer>(search_server.release(), [slot](const SearchServer* released) {
+		slot->released.store(const_cast<SearchServer*>(released), memory_order_release);
+	});
+}
+
+bool SnapshotSearchServer::TryReclaimWorking()
+{
+	if (working_) {
+		return true;
+	}
+	working_.reset(retired_slot_->released.exchange(nullptr, memory_order_acquire));
+	if (!working_) {
+		return false;
+	}
+	retired_slot_.reset();
+	for (const Change& change : working_backlog_) {
+		ApplyChange(*working_, change);
+	}
+	working_backlog_.clear();
+	return true;
+}
+
+void SnapshotSearchServer::CheckAddDocument(int document_id, std::string_view document) const
+{
+	// опубликованный экземпляр плюс неопубликованные изменения - состояние, которое было бы у рабочего
+	bool is_present = document_id >= 0 && atomic_load(&published_)->HasDocument(document_id);
+	for (const Change& change : unpublished_changes_) {
+		if (change.document_id == document_id) {
+			is_present = !change.is_remove;
+		}
+	}
+	if (document_id < 0 || is_present) {
+		throw invalid_argument("Invalid document_id"s);
+	}
+	vector<string_view> words;
+	if (!SplitIntoWordsChecked(document, words)) {
+		for (string_view word : words) {
+			if (any_of(word.begin(), word.end(), [](char c) { return c >= '\0' && c < ' '; })) {
+				throw invalid_argument("Word "s + string(word) + " is invalid"s);
+			}
+		}
+	}
+}
+
+void SnapshotSearchServer::RecordChange(Change change)
+{
+	if (!working_) {
+		working_backlog_.push_back(change);
+	}
+	unpublished_changes_.push_back(move(change));
+}
+
+void SnapshotSearchServer::ApplyChange(SearchServer& search_server, const Change& change)
+{
+	if (change.is_remove) {
+		search_server.RemoveDocument(change.document_id);
+	}
+	else {
+		search_server.AddDocument(change.document_id, change.document, change.status, change.ratings);
+	}
+}
@@ -0,0 +1,109 @@
+#pragma once
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <atomic>
+#include <utility>
+
+#include "search_server.h"
+
+// Поисковый сервер, который можно опрашивать во время добавления и удаления документов.
+// Хранит два экземпляра SearchServer: опубликованный (только для чтения) и рабочий.
+// Изменения применяются к рабочему экземпляру и становятся видны читателям после Publish(),
+// который атомарно подменяет опубликованный экземпляр (RCU на shared_ptr). Старый экземпляр
+// возвращается писателю, когда читатели отпустят последний снимок, и на нём повторяются накопленные изменения.
+// Писатель не ждёт читателей: пока старый экземпляр занят, изменения только копятся.
+// Запросы выполняются без блокировок над снимком, полученным в начале запроса.
+// Цена - двойной объём памяти под индекс.
+class SnapshotSearchServer {
+public:
+	template <typename StringContainer>
+	explicit SnapshotSearchServer(const StringContainer& stop_words)
+		: working_(std::make_unique<SearchServer>(stop_words)) {
+		published_ = MakePublished(std::make_unique<SearchServer>(stop_words), published_slot_);
+	}
+
+	explicit SnapshotSearchServer(const std::string& stop_words_text)
+		: SnapshotSearchServer(static_cast<std::string_view>(stop_words_text)) {
+	}
+
+	explicit SnapshotSearchServer(std::string_view stop_words_text)
+		: SnapshotSearchServer(SplitIntoWordsView(stop_words_text)) {
+	}
+
+	// изменения рабочего экземпляра, невидимы для запросов до Publish()
+	void AddDocument(int document_id, std::string_view document, DocumentStatus status,
+		const std::vector<int>& ratings);
+
+	void RemoveDocument(int document_id);
+
+	// публикует накопленные изменения; запросы, начатые раньше, дорабатывают со старым снимком.
+	// возвращает false, если рабочего экземпляра нет - читатели ещё держат снимок, опубликованный до прошлого
+	// Publish(); тогда изменения остаются ожидающими до следующего вызова
+	bool Publish();
+
+	// снимок, над которым можно выполнить несколько согласованных запросов.
+	// пока снимок удерживается, Publish() может опубликовать изменения не больше одного раза
+	std::shared_ptr<const SearchServer> GetSnapshot() const {
+		return std::atomic_load(&published_);
+	}
+
+	template <typename... Args>
+	std::vector<Document> FindTopDocuments(Args&&... args) const {
+		return GetSnapshot()->FindTopDocuments(std::forward<Args>(args)...);
+	}
+
+	// найденные слова ссылаются на строку запроса, а не на снимок
+	template <typename... Args>
+	SearchServer::ReturnMatch MatchDocument(Args&&... args) const {
+		return GetSnapshot()->MatchDocument(std::forward<Args>(args)...);
+	}
+
+	int GetDocumentCount() const {
+		return GetSnapshot()->GetDocumentCount();
+	}
+
+private:
+	// изменение, которое нужно повторить на втором экземпляре
+	struct Change {
+		bool is_remove;
+		int document_id;
+		std::string document;
+		DocumentStatus status;
+		std::vector<int> ratings;
+	};
+
+	// куда возвращается опубликованный экземпляр, когда отпущен последний снимок с ним.
+	// запись с release и чтение с acquire упорядочивают доступ читателей и следующую запись писателя.
+	// если экземпляр так и не забрали, его удаляет слот
+	struct ReleaseSlot {
+		std::atomic<SearchServer*> released{ nullptr };
+
+		~ReleaseSlot() {
+			delete released.load(std::memory_order_acquire);
+		}
+	};
+
+	std::shared_ptr<const SearchServer> published_; // доступ только через atomic_load/atomic_exchange
+	std::shared_ptr<ReleaseSlot> published_slot_;
+	std::shared_ptr<ReleaseSlot> retired_slot_; // слот прошлого опубликованного экземпляра, пока он не вернулся
+	std::unique_ptr<SearchServer> working_; // nullptr, пока прошлый опубликованный экземпляр занят читателями
+	std::vector<Change> unpublished_changes_; // изменения, которых нет в опубликованном экземпляре
+	std::vector<Change> working_backlog_; // изменения, которых нет в рабочем экземпляре, пока его нет
+	std::mutex writer_mutex_;
+
+	static std::shared_ptr<const SearchServer> MakePublished(std::unique_ptr<SearchServer> search_server,
+		std::shared_ptr<ReleaseSlot>& slot);
+
+	// забирает вернувшийся экземпляр и догоняет на нём изменения; false, если он ещё занят
+	bool TryReclaimWorking();
+
+	// проверка добавления без рабочего экземпляра: те же исключения, что у SearchServer::AddDocument
+	void CheckAddDocument(int document_id, std::string_view document) const;
+
+	void RecordChange(Change change);
+
+	static void ApplyChange(SearchServer& search_server, const Change& change);
+};
@@ -1,6 +1,13 @@
 #include "string_processing.h"
 #include <algorithm>
 #include <sstream>
+#include <cstdint>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
 /*
 //хуже на ~100сек, наверное из потока читать затратнее
 std::vector<std::string> SplitIntoWords(const std::string &text) {
@@ -37,21 +44,114 @@ std::vector<std::string> SplitIntoWords(const std::string& text)
 }
 //из задания со string_view
 std::vector<std::string_view> SplitIntoWordsView(std::string_view str) {
-
 	std::vector<std::string_view> result;
-	str.remove_prefix(std::min(str.find_first_not_of(" "), str.size()));
-	while (!str.empty()) {
-		auto space = str.find(' ');
-		result.push_back(str.substr(0, space));
-
-		if (str.find(' ') != str.npos)
-		{
-			str.remove_prefix(space);
-			str.remove_prefix(std::min(str.find_first_not_of(" "), str.size()));
+	SplitIntoWordsChecked(str, result);
+	return result;
+}
+
+namespace {
+
+// состояние разбора между блоками: начало текущего слова, если позиция внутри слова
+struct WordScanner {
+	std::string_view text;
+	std::vector<std::string_view>& words;
+	bool in_word = false;
+	size_t word_begin = 0;
+
+	// обрабатывает блок из block_size байт с позиции pos по маске пробелов (бит i - байт pos + i)
+	void ScanBlock(size_t pos, uint64_t space_mask, size_t block_size) {
+		const uint64_t block_mask = block_size == 64 ? ~uint64_t{ 0 } : (uint64_t{ 1 } << block_size) - 1;
+		const uint64_t word_mask = ~space_mask & block_mask;
+		uint64_t cursor_mask = block_mask;
+		while (true) {
+			const uint64_t candidates = (in_word ? space_mask : word_mask) & cursor_mask;
+			if (candidates == 0) {
+				return;
+			}
+			const int bit = CountTrailingZeros(candidates);
+			if (in_word) {
+				words.push_back(text.substr(word_begin, pos + bit - word_begin));
+			}
+			else {
+				word_begin = pos + bit;
+			}
+			in_word = !in_word;
+			cursor_mask = block_mask & (~uint64_t{ 0 } << bit);
 		}
-		else {
-			str.remove_prefix(str.size());
+	}
+
+	void Finish() {
+		if (in_word) {
+			words.push_back(text.substr(word_begin));
 		}
 	}
-	return result;
-}
\ No newline at end of file
+
+	static int CountTrailingZeros(uint64_t value) {
+#if defined(__GNUC__) || defined(__clang__)
+		return __builtin_ctzll(value);
+#else
+		int result = 0;
+		while ((value & 1) == 0) {
+			value >>= 1;
+			++result;
+		}
+		return result;
+#endif
+	}
+};
+
+bool IsControlChar(char c) {
+	return static_cast<unsigned char>(c) < static_cast<unsigned char>(' ');
+}
+
+} // namespace
+
+bool SplitIntoWordsChecked(std::string_view text, std::vector<std::string_view>& words)
+{
+	WordScanner scanner{ text, words };
+	const char* data = text.data();
+	const size_t size = text.size();
+	size_t pos = 0;
+	bool has_control_chars = false;
+
+#if defined(__AVX2__)
+	const __m256i spaces = _mm256_set1_epi8(' ');
+	const __m256i max_control = _mm256_set1_epi8(' ' - 1);
+	__m256i control_found = _mm256_setzero_si256();
+	for (; pos + 32 <= size; pos += 32) {
+		const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos));
+		// байт <= 31 без учёта знака: min(байт, 31) == байт
+		control_found = _mm256_or_si256(control_found, _mm256_cmpeq_epi8(_mm256_min_epu8(block, max_control), block));
+		const uint32_t space_mask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, spaces)));
+		scanner.ScanBlock(pos, space_mask, 32);
+	}
+	has_control_chars = _mm256_movemask_epi8(control_found) != 0;
+#elif defined(__SSE2__) || defined(_M_X64)
+	const __m128i spaces = _mm_set1_epi8(' ');
+	const __m128i max_control = _mm_set1_epi8(' ' - 1);
+	__m128i control_found = _mm_setzero_si128();
+	for (; pos + 16 <= size; pos += 16) {
+		const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+		// байт <= 31 без учёта знака: min(байт, 31) == байт
+		control_found = _mm_or_si128(control_found, _mm_cmpeq_epi8(_mm_min_epu8(block, max_control), block));
+		const uint32_t space_mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, spaces)));
+		scanner.ScanBlock(pos, space_mask, 16);
+	}
+	has_control_chars = _mm_movemask_epi8(control_found) != 0;
+#endif
+
+	// хвост, а без SIMD - весь текст, блоками по 64 байта
+	while (pos < size) {
+		const size_t block_size = std::min<size_t>(64, size - pos);
+		uint64_t space_mask = 0;
+		for (size_t i = 0; i < block_size; ++i) {
+			const char c = data[pos + i];
+			space_mask |= uint64_t{ c == ' ' } << i;
+			has_control_chars |= IsControlChar(c);
+		}
+		scanner.ScanBlock(pos, space_mask, block_size);
+		pos += block_size;
+	}
+	scanner.Finish();
+	return !has_control_chars;
+}
@@ -2,10 +2,37 @@
 #include <vector>
 #include <string>
 #include <set>
+#include <string_view>
 
 std::vector<std::string> SplitIntoWords(const std::string& text);
 std::vector<std::string_view> SplitIntoWordsView(std::string_view str);
 
+// разбивает text на слова по пробелам, дописывая их в words (буфер вызывающего).
+// за тот же проход проверяет управляющие символы (коды 0-31): возвращает false, если они есть в тексте.
+// использует AVX2 или SSE2, если они доступны при компиляции, иначе - побайтовый разбор
+bool SplitIntoWordsChecked(std::string_view text, std::vector<std::string_view>& words);
+
+// ленивое разбиение на слова без выделения памяти: action вызывается для каждого слова по порядку
+template <typename Action>
+void ForEachWordView(std::string_view text, Action action)
+{
+	const size_t size = text.size();
+	size_t pos = 0;
+	while (true) {
+		while (pos < size && text[pos] == ' ') {
+			++pos;
+		}
+		if (pos == size) {
+			return;
+		}
+		const size_t word_begin = pos;
+		while (pos < size && text[pos] != ' ') {
+			++pos;
+		}
+		action(std::string_view(text.data() + word_begin, pos - word_begin));
+	}
+}
+
 template <typename StringContainer>
 std::set<std::string,std::less<>> MakeUniqueNonEmptyStrings(const StringContainer& strings)// std::less<> std::string_view
 {
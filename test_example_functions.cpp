@@ -1,6 +1,15 @@
 #include "test_example_functions.h"
+#include "concurrent_map.h"
+#include "snapshot_search_server.h"
+#include "batch_query_executor.h"
+#include "process_queries.h"
+#include "async_search_server.h"
+#include "request_queue.h"
 #include "log_duration.h"
 
+#include <fstream>
+#include <random>
+
 using namespace std;
 
 void PrintDocument(const Document& document)
@@ -158,7 +167,7 @@ void TestAddDocument()
 	//
 	const vector<Document> documents_ids = { { 0,0.173286,2 },{ 2,0.173286,-1 } };
 	ASSERT(documents_ids == search_server.FindTopDocuments("пушистый ухоженный кот"s,
-		[](int document_id, DocumentStatus status, int rating) { return document_id % 2 == 0; }));
+		[](int document_id, DocumentStatus, int) { return document_id % 2 == 0; }));
 }
 void TestRatingPlus()
 {
@@ -224,7 +233,7 @@ void TestSearchPredicate()
 	{
 		const vector<Document> documents_ids = { { 3,0.231049,9 }, { 0,0.173286,2 } };
 		auto document_current_id = search_server.FindTopDocuments("пушистый ухоженный кот"s,
-			[](int document_id, DocumentStatus status, int rating) { return document_id % 3 == 0; });
+			[](int document_id, DocumentStatus, int) { return document_id % 3 == 0; });
 		ASSERT(documents_ids == document_current_id);
 
 	}
@@ -232,14 +241,14 @@ void TestSearchPredicate()
 	{
 		const vector<Document> documents_status = { { 1, 0.866433, 5 } };
 		auto document_current_status = search_server.FindTopDocuments("пушистый ухоженный кот"s,
-			[](int document_id, DocumentStatus status, int rating) { return status == DocumentStatus::BANNED; });
+			[](int, DocumentStatus status, int) { return status == DocumentStatus::BANNED; });
 		ASSERT(documents_status == document_current_status);
 	}
 	//rating
 	{
 		const vector<Document> documents_rating = { { 1, 0.866433, 5 } ,{ 3,0.231049,9 },{ 0,0.173286,2 } };
 		auto document_current_rating = search_server.FindTopDocuments("пушистый ухоженный кот"s,
-			[](int document_id, DocumentStatus status, int rating) { return rating > 0; });
+			[](int, DocumentStatus, int rating) { return rating > 0; });
 		ASSERT(documents_rating == document_current_rating);
 	}
 }
@@ -319,6 +328,953 @@ void TestResultsSortRelevanceEpsError()
 	}
 }
 
+//удаление документа не должно портить слова и частоты оставшихся документов
+void TestRemoveDocument()
+{
+	SearchServer search_server("и в на"s);
+	search_server.AddDocument(1, "пушистый кот пушистый хвост"s, DocumentStatus::ACTUAL, { 7, 2, 7 });
+	search_server.AddDocument(2, "пушистый пёс и кот"s, DocumentStatus::ACTUAL, { 5 });
+	search_server.AddDocument(3, "ухоженный скворец"s, DocumentStatus::ACTUAL, { 9 });
+
+	search_server.RemoveDocument(1);
+	search_server.RemoveDocument(execution::par, 3);
+	ASSERT_EQUAL(search_server.GetDocumentCount(), 1);
+	ASSERT(search_server.GetWordFrequencies(1).empty());
+
+	const auto& word_freqs = search_server.GetWordFrequencies(2);
+	ASSERT_EQUAL(word_freqs.size(), 3u);
+	ASSERT(word_freqs.count("пушистый"sv) == 1);
+	ASSERT(abs(word_freqs.at("кот"sv) - 1.0 / 3) < EXP);
+
+	const auto found_docs = search_server.FindTopDocuments("пушистый кот скворец"s);
+	ASSERT_EQUAL(found_docs.size(), 1u);
+	ASSERT_EQUAL(found_docs[0].id, 2);
+	ASSERT(search_server.FindTopDocuments("хвост"s).empty());
+}
+
+//количество документов в выдаче задаётся вызывающим, параллельный отбор совпадает с последовательным
+void TestFindTopDocumentsMaxCount()
+{
+	SearchServer search_server("и в на"s);
+	for (int id = 0; id < 500; ++id) {
+		search_server.AddDocument(id, "кот "s + string(id % 7 + 1, 'a') + " хвост"s, DocumentStatus::ACTUAL, { id });
+	}
+	const string query = "кот aaa -aaaaaaa"s;
+	ASSERT_EQUAL(search_server.FindTopDocuments(query).size(), static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT));
+	ASSERT(search_server.FindTopDocuments(query, DocumentStatus::ACTUAL, 0).empty());
+
+	const auto seq_docs = search_server.FindTopDocuments(query, DocumentStatus::ACTUAL, 100);
+	ASSERT_EQUAL(seq_docs.size(), 100u);
+	ASSERT(is_sorted(seq_docs.begin(), seq_docs.end(), [](const Document& lhs, const Document& rhs) {
+		return lhs.relevance > rhs.relevance + EXP; }));
+	const auto par_docs = search_server.FindTopDocuments(execution::par, query, DocumentStatus::ACTUAL, 100);
+	ASSERT_EQUAL(par_docs.size(), 100u);
+	for (size_t i = 0; i < seq_docs.size(); ++i) {
+		ASSERT_EQUAL(seq_docs[i].id, par_docs[i].id);
+	}
+	ASSERT_EQUAL(search_server.FindTopDocuments(execution::par, query, DocumentStatus::ACTUAL, 1000).size(), 429u);
+}
+
+void TestConcurrentMap()
+{
+	ConcurrentMap<int, int> int_map(7);
+	vector<int> keys(10000);
+	iota(keys.begin(), keys.end(), -5000);
+	for_each(execution::par, keys.begin(), keys.end(), [&int_map](int key) {
+		int_map[key % 1000].ref_to_value += 1;
+	});
+	ASSERT_EQUAL(int_map.size(), 1999u);
+	ASSERT_EQUAL(int_map.Find(0).value_or(0), 10);
+	ASSERT_EQUAL(int_map.Find(999).value_or(0), 5);
+	ASSERT(!int_map.Find(1000).has_value());
+
+	for_each(execution::par, keys.begin(), keys.end(), [&int_map](int key) {
+		if (key % 2 == 0) {
+			int_map.Erase(key % 1000);
+		}
+	});
+	const auto ordinary_map = int_map.BuildOrdinaryMap();
+	ASSERT_EQUAL(ordinary_map.size(), 1000u);
+	ASSERT(all_of(ordinary_map.begin(), ordinary_map.end(), [](const auto& item) { return item.first % 2 != 0; }));
+
+	ConcurrentMap<string_view, double> word_map(3);
+	word_map["кот"sv].ref_to_value += 0.5;
+	word_map["кот"sv].ref_to_value += 0.25;
+	ASSERT(abs(word_map.Find("кот"sv).value_or(0) - 0.75) < EXP);
+	ASSERT_EQUAL(word_map.Erase("пёс"sv), 0u);
+	ASSERT_EQUAL(word_map.Erase("кот"sv), 1u);
+	ASSERT(word_map.BuildOrdinaryMap().empty());
+}
+
+//запросы видят только опубликованные изменения и не ждут писателя
+void TestSnapshotSearchServer()
+{
+	SnapshotSearchServer search_server("и в на"s);
+	search_server.AddDocument(1, "пушистый кот"s, DocumentStatus::ACTUAL, { 7 });
+	ASSERT(search_server.FindTopDocuments("кот"s).empty());
+	search_server.Publish();
+	ASSERT_EQUAL(search_server.FindTopDocuments("кот"s).size(), 1u);
+
+	atomic_bool done = false;
+	atomic_int inconsistent = 0;
+	vector<thread> readers;
+	for (int i = 0; i < 4; ++i) {
+		readers.emplace_back([&] {
+			while (!done) {
+				const auto snapshot = search_server.GetSnapshot();
+				const int document_count = snapshot->GetDocumentCount();
+				//документы публикуются парами, снимок не может содержать половину пары
+				if (document_count % 2 == 0 || static_cast<int>(snapshot->FindTopDocuments("кот"s, DocumentStatus::ACTUAL, 1000).size()) != document_count) {
+					++inconsistent;
+				}
+			}
+		});
+	}
+	for (int id = 2; id < 200; id += 2) {
+		search_server.AddDocument(id, "кот номер "s + to_string(id), DocumentStatus::ACTUAL, { id });
+		search_server.AddDocument(id + 1, "кот номер "s + to_string(id + 1), DocumentStatus::ACTUAL, { id });
+		search_server.Publish();
+	}
+	search_server.RemoveDocument(1);
+	search_server.RemoveDocument(2);
+	search_server.Publish();
+	done = true;
+	for (auto& reader : readers) {
+		reader.join();
+	}
+	ASSERT_EQUAL(inconsistent.load(), 0);
+	//читатели могли держать старый снимок во время последних Publish - тогда изменения ещё ждут
+	ASSERT(search_server.Publish());
+	ASSERT_EQUAL(search_server.GetDocumentCount(), 197);
+	const auto[words, status] = search_server.MatchDocument("кот -номер"s, 3);
+	ASSERT(words.empty());
+}
+
+//удерживаемый снимок не блокирует писателя: изменения ждут, пока старый экземпляр не освободится
+void TestSnapshotHeldAcrossPublish()
+{
+	SnapshotSearchServer search_server("и в на"s);
+	search_server.AddDocument(1, "пушистый кот"s, DocumentStatus::ACTUAL, { 7 });
+	ASSERT(search_server.Publish());
+	{
+		const auto snapshot = search_server.GetSnapshot();
+		search_server.AddDocument(2, "белый кот"s, DocumentStatus::ACTUAL, { 5 });
+		//публикация не ждёт: снимок держит старый экземпляр, новый опубликован рядом с ним
+		ASSERT(search_server.Publish());
+		ASSERT_EQUAL(snapshot->GetDocumentCount(), 1);
+		ASSERT_EQUAL(search_server.GetDocumentCount(), 2);
+
+		//теперь snapshot держит экземпляр, который должен стать рабочим
+		search_server.AddDocument(3, "рыжий кот"s, DocumentStatus::ACTUAL, { 3 });
+		search_server.RemoveDocument(1);
+		ASSERT(!search_server.Publish());
+		ASSERT_EQUAL(search_server.GetDocumentCount(), 2);
+		//проверки добавления работают и без рабочего экземпляра
+		try {
+			search_server.AddDocument(3, "кот"s, DocumentStatus::ACTUAL, { 1 });
+			ASSERT_HINT(false, "duplicate id must throw"s);
+		}
+		catch (const invalid_argument&) {
+		}
+		try {
+			search_server.AddDocument(4, "ко\x12т"s, DocumentStatus::ACTUAL, { 1 });
+			ASSERT_HINT(false, "invalid word must throw"s);
+		}
+		catch (const invalid_argument&) {
+		}
+		search_server.AddDocument(1, "серый кот"s, DocumentStatus::ACTUAL, { 1 });
+		ASSERT_EQUAL(snapshot->GetDocumentCount(), 1);
+	}
+	ASSERT(search_server.Publish());
+	ASSERT_EQUAL(search_server.GetDocumentCount(), 3);
+	ASSERT_EQUAL(search_server.FindTopDocuments("серый"s).size(), 1u);
+	ASSERT(search_server.FindTopDocuments("пушистый"s).empty());
+
+	//изменения догоняют и второй экземпляр
+	search_server.RemoveDocument(3);
+	ASSERT(search_server.Publish());
+	ASSERT_EQUAL(search_server.GetDocumentCount(), 2);
+	ASSERT(search_server.FindTopDocuments("рыжий"s).empty());
+	ASSERT_EQUAL(search_server.FindTopDocuments("белый"s).size(), 1u);
+}
+
+//пакетное добавление строит тот же индекс, что и добавление по одному документу
+void TestAddDocuments()
+{
+	const vector<string> texts = { "белый кот и модный ошейник"s, "пушистый кот пушистый хвост"s,
+		"ухоженный пёс выразительные глаза"s, "ухоженный скворец евгений"s, ""s };
+	SearchServer single_server("и в на"s);
+	SearchServer batch_server("и в на"s);
+	vector<RawDocument> batch;
+	for (int id = 0; id < static_cast<int>(texts.size()); ++id) {
+		single_server.AddDocument(id * 2, texts[id], DocumentStatus::ACTUAL, { id, 5 });
+		batch.push_back({ id * 2, texts[id], DocumentStatus::ACTUAL, { id, 5 } });
+	}
+	batch_server.AddDocument(1, "кот"s, DocumentStatus::BANNED, { 1 });
+	batch_server.AddDocuments(execution::par, batch);
+	batch_server.RemoveDocument(1);
+
+	ASSERT_EQUAL(batch_server.GetDocumentCount(), single_server.GetDocumentCount());
+	for (const int id : single_server) {
+		ASSERT(batch_server.GetWordFrequencies(id) == single_server.GetWordFrequencies(id));
+	}
+	const string query = "пушистый ухоженный кот -евгений"s;
+	ASSERT(batch_server.FindTopDocuments(query) == single_server.FindTopDocuments(query));
+
+	//повторный id и некорректные слова не меняют сервер
+	vector<RawDocument> bad_ids = { { 100, "кот"sv, DocumentStatus::ACTUAL, { 1 } }, { 100, "пёс"sv, DocumentStatus::ACTUAL, { 1 } } };
+	vector<RawDocument> bad_words = { { 101, "кот"sv, DocumentStatus::ACTUAL, { 1 } }, { 102, "п\x12ёс"sv, DocumentStatus::ACTUAL, { 1 } } };
+	for (const auto& bad_batch : { bad_ids, bad_words }) {
+		try {
+			batch_server.AddDocuments(execution::par, bad_batch);
+			ASSERT_HINT(false, "invalid batch must throw"s);
+		}
+		catch (const invalid_argument&) {
+		}
+	}
+	ASSERT_EQUAL(batch_server.GetDocumentCount(), 5);
+}
+
+//загруженный из файла сервер отвечает так же, как сохранённый
+void TestSaveLoad()
+{
+	SearchServer search_server("и в на"s);
+	search_server.AddDocument(0, "белый кот и модный ошейник"s, DocumentStatus::ACTUAL, { 8, -3 });
+	search_server.AddDocument(1, "пушистый кот пушистый хвост"s, DocumentStatus::ACTUAL, { 7, 2, 7 });
+	search_server.AddDocument(2, "ухоженный пёс выразительные глаза"s, DocumentStatus::BANNED, { 5, -12, 2, 1 });
+	search_server.AddDocument(5, "ухоженный скворец евгений"s, DocumentStatus::ACTUAL, { 9 });
+	search_server.RemoveDocument(0);
+
+	const string path = "search_server_test_index.bin"s;
+	// повторное сохранение заменяет файл целиком, временный файл не остаётся
+	SearchServer("и"s).Save(path);
+	search_server.Save(path);
+	ASSERT(!ifstream(path + ".tmp"s));
+	const SearchServer loaded_server = SearchServer::Load(path);
+	SearchServer changed_server = SearchServer::Load(path);
+	//отображение файла переживает его удаление
+	remove(path.c_str());
+
+	ASSERT_EQUAL(loaded_server.GetDocumentCount(), search_server.GetDocumentCount());
+	for (const int id : search_server) {
+		ASSERT(loaded_server.GetWordFrequencies(id) == search_server.GetWordFrequencies(id));
+	}
+	for (const string& query : { "пушистый ухоженный кот"s, "кот и -хвост"s, "белый"s }) {
+		ASSERT(loaded_server.FindTopDocuments(query) == search_server.FindTopDocuments(query));
+		ASSERT(loaded_server.FindTopDocuments(query, DocumentStatus::BANNED) == search_server.FindTopDocuments(query, DocumentStatus::BANNED));
+	}
+	ASSERT(loaded_server.FindTopDocuments("и"s).empty());
+	const auto[words, status] = loaded_server.MatchDocument("ухоженный пёс"s, 2);
+	ASSERT_EQUAL(words.size(), 2u);
+	ASSERT(status == DocumentStatus::BANNED);
+	ASSERT_EQUAL(loaded_server.GetDocumentText(5), "ухоженный скворец евгений"s);
+
+	//загруженный сервер можно менять: затронутые списки, слова документов и тексты копируются из файла к себе
+	const auto check_same = [&search_server](const SearchServer& server) {
+		ASSERT_EQUAL(server.GetDocumentCount(), search_server.GetDocumentCount());
+		for (const int id : search_server) {
+			ASSERT(server.GetWordFrequencies(id) == search_server.GetWordFrequencies(id));
+			ASSERT_EQUAL(server.GetDocumentText(id), search_server.GetDocumentText(id));
+		}
+		for (const string& query : { "пушистый ухоженный кот"s, "скворец -хвост"s, "белый евгений"s }) {
+			ASSERT(server.FindTopDocuments(query) == search_server.FindTopDocuments(query));
+		}
+	};
+	for (SearchServer* server : { &search_server, &changed_server }) {
+		server->AddDocument(7, "пушистый скворец"s, DocumentStatus::ACTUAL, { 3 });
+		server->RemoveDocument(1);
+	}
+	check_same(changed_server);
+	search_server.Compact();
+	changed_server.Compact();
+	check_same(changed_server);
+	changed_server.Save(path);
+	check_same(SearchServer::Load(path));
+
+	//обрезанный файл не загружается
+	{
+		ifstream in(path, ios::binary);
+		const string bytes((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+		in.close();
+		ofstream(path, ios::binary | ios::trunc).write(bytes.data(), bytes.size() / 2);
+	}
+	try {
+		SearchServer::Load(path);
+		ASSERT_HINT(false, "truncated file must throw"s);
+	}
+	catch (const runtime_error&) {
+	}
+	remove(path.c_str());
+
+	try {
+		SearchServer::Load("search_server_missing_index.bin"s);
+		ASSERT_HINT(false, "missing file must throw"s);
+	}
+	catch (const runtime_error&) {
+	}
+}
+
+//одинаковые после разбора запросы берутся из кеша, изменение документов сбрасывает кеш
+void TestResultCache()
+{
+	SearchServer search_server("и в на"s);
+	search_server.AddDocument(0, "белый кот и модный ошейник"s, DocumentStatus::ACTUAL, { 8, -3 });
+	search_server.AddDocument(1, "пушистый кот пушистый хвост"s, DocumentStatus::ACTUAL, { 7, 2, 7 });
+	search_server.EnableResultCache(100);
+
+	const auto first = search_server.FindTopDocuments("пушистый кот"s);
+	const auto second = search_server.FindTopDocuments(execution::par, "кот пушистый кот и"s);
+	ASSERT(first == second);
+	ASSERT_EQUAL(search_server.GetResultCacheStats().hits, 1u);
+	ASSERT_EQUAL(search_server.GetResultCacheStats().misses, 1u);
+
+	//другой статус и произвольный предикат
+	ASSERT(search_server.FindTopDocuments("пушистый кот"s, DocumentStatus::BANNED).empty());
+	search_server.FindTopDocuments("пушистый кот"s, [](int, DocumentStatus, int) { return true; });
+	ASSERT_EQUAL(search_server.GetResultCacheStats().misses, 2u);
+
+	search_server.AddDocument(2, "пушистый пушистый кот"s, DocumentStatus::ACTUAL, { 1 });
+	const auto after_add = search_server.FindTopDocuments("пушистый кот"s);
+	ASSERT_EQUAL(after_add.size(), 3u);
+	ASSERT_EQUAL(after_add[0].id, 2);
+	search_server.RemoveDocument(2);
+	ASSERT(search_server.FindTopDocuments("пушистый кот"s) == first);
+	ASSERT_EQUAL(search_server.GetResultCacheStats().misses, 4u);
+	ASSERT_EQUAL(search_server.GetResultCacheStats().hits, 1u);
+}
+
+//разбиение на слова блоками совпадает с побайтовым на границах блоков
+void TestSplitIntoWords()
+{
+	mt19937 generator(7);
+	const string alphabet = "  ab\xd0\xba-"s;
+	for (int iteration = 0; iteration < 500; ++iteration) {
+		string text(uniform_int_distribution(0, 200)(generator), ' ');
+		for (char& c : text) {
+			c = alphabet[uniform_int_distribution<size_t>(0, alphabet.size() - 1)(generator)];
+		}
+		const bool with_control = iteration % 5 == 0 && !text.empty();
+		if (with_control) {
+			text[uniform_int_distribution<size_t>(0, text.size() - 1)(generator)] = '\t';
+		}
+		vector<string_view> expected;
+		ForEachWordView(text, [&expected](string_view word) { expected.push_back(word); });
+		vector<string_view> words;
+		ASSERT_EQUAL(SplitIntoWordsChecked(text, words), !with_control);
+		ASSERT(words == expected);
+		ASSERT(SplitIntoWordsView(text) == expected);
+	}
+	vector<string_view> words = { "начало"sv };
+	ASSERT(SplitIntoWordsChecked("  кот   и\x7f пёс "sv, words));
+	ASSERT((words == vector<string_view>{ "начало"sv, "кот"sv, "и\x7f"sv, "пёс"sv }));
+}
+
+//номера слов выдаются по порядку, строки возвращаются только на границе API
+void TestTermIds()
+{
+	InvertedIndex index;
+	ASSERT_EQUAL(index.FindTermId("кот"sv), InvertedIndex::NO_TERM);
+	ASSERT_EQUAL(index.AddTerm("кот"sv), 0u);
+	ASSERT_EQUAL(index.AddTerm("пёс"sv), 1u);
+	ASSERT_EQUAL(index.AddTerm("кот"sv), 0u);
+	ASSERT_EQUAL(index.FindTermId("пёс"sv), 1u);
+	ASSERT_EQUAL(index.GetTerm(1), "пёс"sv);
+	ASSERT(index.Find("кот"sv) != nullptr && index.Find("кот"sv)->empty());
+	ASSERT(index.Find("мышь"sv) == nullptr);
+
+	SearchServer search_server("и в на"s);
+	search_server.AddDocument(1, "белый кот и модный ошейник"s, DocumentStatus::ACTUAL, { 1 });
+	search_server.AddDocument(2, "пушистый кот пушистый хвост"s, DocumentStatus::ACTUAL, { 2 });
+	search_server.RemoveDocument(1);
+	search_server.AddDocument(3, "ухоженный пёс ошейник"s, DocumentStatus::ACTUAL, { 3 });
+	const map<string_view, double> expected = { { "кот"sv, 0.25 }, { "пушистый"sv, 0.5 }, { "хвост"sv, 0.25 } };
+	ASSERT(search_server.GetWordFrequencies(2) == expected);
+	ASSERT(search_server.GetWordFrequencies(1).empty());
+	//найденные слова ссылаются на строку запроса - она должна жить дольше результата
+	const string query = "пушистый ошейник кот -белый"s;
+	const map<int, vector<string_view>> expected_words = { { 2, { "кот"sv, "пушистый"sv } }, { 3, { "ошейник"sv } } };
+	for (const auto&[document_id, document_words] : expected_words) {
+		const auto[seq_words, seq_status] = search_server.MatchDocument(query, document_id);
+		const auto[par_words, par_status] = search_server.MatchDocument(execution::par, query, document_id);
+		ASSERT(seq_words == document_words);
+		ASSERT(par_words == document_words);
+		ASSERT(seq_status == DocumentStatus::ACTUAL && par_status == DocumentStatus::ACTUAL);
+	}
+	const string minus_query = "кот хвост -пушистый"s;
+	const auto[words, status] = search_server.MatchDocument(execution::par, minus_query, 2);
+	ASSERT(words.empty());
+}
+
+//сжатый список документов совпадает с обычным словарём после вставок и удалений в произвольном порядке
+void TestPostingList()
+{
+	mt19937 generator(11);
+	InvertedIndex::PostingList postings;
+	map<int, InvertedIndex::FreqCode> expected;
+	for (int iteration = 0; iteration < 5000; ++iteration) {
+		const int ordinal = uniform_int_distribution(0, 2000)(generator);
+		if (iteration % 3 == 2) {
+			postings.Erase(ordinal);
+			expected.erase(ordinal);
+		}
+		else {
+			const auto freq_code = uniform_int_distribution<InvertedIndex::FreqCode>(0, 300)(generator);
+			postings.Insert(ordinal, freq_code);
+			expected[ordinal] = freq_code;
+		}
+	}
+	ASSERT_EQUAL(postings.size(), expected.size());
+	auto it = expected.begin();
+	for (InvertedIndex::PostingList::Cursor cursor(postings); !cursor.AtEnd(); cursor.Next(), ++it) {
+		ASSERT(it != expected.end());
+		ASSERT_EQUAL(cursor.GetOrdinal(), it->first);
+		ASSERT_EQUAL(cursor.GetFreqCode(), it->second);
+	}
+	ASSERT(it == expected.end());
+	for (int ordinal = -1; ordinal <= 2002; ordinal += 7) {
+		ASSERT_EQUAL(postings.Contains(ordinal), expected.count(ordinal) > 0);
+		InvertedIndex::PostingList::Cursor cursor(postings);
+		cursor.SkipTo(ordinal / 2);
+		cursor.SkipTo(ordinal);
+		const auto next = expected.lower_bound(ordinal);
+		ASSERT_EQUAL(cursor.AtEnd(), next == expected.end());
+		if (!cursor.AtEnd()) {
+			ASSERT_EQUAL(cursor.GetOrdinal(), next->first);
+		}
+	}
+
+	// соседние документы с одной частотой занимают чуть больше двух байт вместо двенадцати
+	InvertedIndex::PostingList dense;
+	for (int ordinal = 0; ordinal < 10000; ++ordinal) {
+		dense.Insert(ordinal, 1);
+	}
+	ASSERT(dense.GetByteSize() < 10000 * (sizeof(int) + sizeof(double)) / 5);
+}
+
+//отсечение документов по оценке сверху не меняет лучшие документы
+void TestTopDocumentsPruning()
+{
+	mt19937 generator(5);
+	const vector<string> words = { "кот"s, "пёс"s, "хвост"s, "ошейник"s, "глаза"s, "шерсть"s, "нос"s, "лапы"s };
+	const auto random_text = [&](int word_count) {
+		string text;
+		for (int i = 0; i < word_count; ++i) {
+			// частые и редкие слова вперемешку
+			const size_t index = static_cast<size_t>(pow(uniform_real_distribution(0.0, 1.0)(generator), 2) * words.size());
+			text += words[index] + " "s;
+		}
+		return text;
+	};
+	SearchServer search_server("и в на"s);
+	for (int id = 0; id < 3000; ++id) {
+		search_server.AddDocument(id, random_text(uniform_int_distribution(1, 20)(generator)), DocumentStatus(id % 3), { id });
+	}
+	for (int iteration = 0; iteration < 50; ++iteration) {
+		string query = random_text(uniform_int_distribution(2, 6)(generator));
+		if (iteration % 4 == 0) {
+			query += "-"s + words[iteration % words.size()];
+		}
+		// при max_count не меньше числа документов порог не появляется и перебор полный
+		const auto all_documents = search_server.FindTopDocuments(query, DocumentStatus::ACTUAL, 3000);
+		for (size_t max_count : { 1u, 5u, 40u }) {
+			const auto seq_documents = search_server.FindTopDocuments(query, DocumentStatus::ACTUAL, max_count);
+			const auto par_documents = search_server.FindTopDocuments(execution::par, query, DocumentStatus::ACTUAL, max_count);
+			ASSERT_EQUAL(seq_documents.size(), min(max_count, all_documents.size()));
+			ASSERT_EQUAL(par_documents.size(), seq_documents.size());
+			for (size_t i = 0; i < seq_documents.size(); ++i) {
+				ASSERT_EQUAL(seq_documents[i].id, all_documents[i].id);
+				ASSERT_EQUAL(seq_documents[i].relevance, all_documents[i].relevance);
+				ASSERT_EQUAL(par_documents[i].id, all_documents[i].id);
+			}
+		}
+	}
+}
+
+//отбор по статусу через множества номеров статусов и минус слов совпадает с отбором предикатом
+void TestStatusFilter()
+{
+	SearchServer search_server("и в на"s);
+	// больше 1024 документов на поток - параллельный поиск делится на части
+	for (int id = 0; id < 3000; ++id) {
+		string text = "кот"s;
+		if (id % 3 == 0) {
+			text += " пушистый"s;
+		}
+		if (id % 5 == 0) {
+			text += " ошейник"s;
+		}
+		search_server.AddDocument(id, text, DocumentStatus(id % 4), { id });
+	}
+	for (int id = 0; id < 3000; id += 11) {
+		search_server.RemoveDocument(id);
+	}
+	for (const string& query : { "кот"s, "кот -ошейник"s, "пушистый ошейник -кот"s, "пушистый кот -ошейник"s }) {
+		for (const DocumentStatus status : { DocumentStatus::ACTUAL, DocumentStatus::IRRELEVANT, DocumentStatus::BANNED, DocumentStatus::REMOVED }) {
+			const auto by_predicate = search_server.FindTopDocuments(query,
+				[status](int, DocumentStatus document_status, int) { return document_status == status; }, 3000);
+			const auto by_status = search_server.FindTopDocuments(query, status, 3000);
+			const auto by_status_par = search_server.FindTopDocuments(execution::par, query, status, 3000);
+			ASSERT_EQUAL(by_status.size(), by_predicate.size());
+			ASSERT_EQUAL(by_status_par.size(), by_predicate.size());
+			for (size_t i = 0; i < by_predicate.size(); ++i) {
+				ASSERT_EQUAL(by_status[i].id, by_predicate[i].id);
+				ASSERT_EQUAL(by_status_par[i].id, by_predicate[i].id);
+				ASSERT(by_status[i].id % 11 != 0);
+				ASSERT(by_status[i].id % 4 == static_cast<int>(status));
+				ASSERT(query.find("-ошейник"s) == string::npos || by_status[i].id % 5 != 0);
+			}
+		}
+	}
+	ASSERT(search_server.FindTopDocuments("пушистый ошейник -кот"s).empty());
+}
+
+//после удаления больше половины документов номера уплотняются, а поиск работает как на сервере только с оставшимися
+void TestCompactOrdinals()
+{
+	const vector<string> texts = { "белый кот и модный ошейник"s, "пушистый кот пушистый хвост"s,
+		"ухоженный пёс выразительные глаза"s, "ухоженный скворец евгений"s, "белый пёс и чёрный хвост"s };
+	SearchServer search_server("и в на"s);
+	SearchServer expected_server("и в на"s);
+	for (int id = 0; id < 300; ++id) {
+		search_server.AddDocument(id, texts[id % texts.size()] + " "s + to_string(id % 7), DocumentStatus(id % 2), { id });
+		if (id % 3 == 0) {
+			expected_server.AddDocument(id, texts[id % texts.size()] + " "s + to_string(id % 7), DocumentStatus(id % 2), { id });
+		}
+	}
+	for (int id = 0; id < 300; ++id) {
+		if (id % 3 != 0) {
+			search_server.RemoveDocument(id);
+		}
+	}
+	search_server.AddDocument(1000, "пушистый пёс 3"s, DocumentStatus::ACTUAL, { 5 });
+	expected_server.AddDocument(1000, "пушистый пёс 3"s, DocumentStatus::ACTUAL, { 5 });
+
+	ASSERT_EQUAL(search_server.GetDocumentCount(), expected_server.GetDocumentCount());
+	ASSERT(vector<int>(search_server.begin(), search_server.end()) == vector<int>(expected_server.begin(), expected_server.end()));
+	for (const string& query : { "пушистый кот"s, "ухоженный пёс -хвост"s, "белый 3 4 -кот"s }) {
+		for (const DocumentStatus status : { DocumentStatus::ACTUAL, DocumentStatus::IRRELEVANT }) {
+			const auto documents = search_server.FindTopDocuments(query, status, 50);
+			const auto expected_documents = expected_server.FindTopDocuments(query, status, 50);
+			ASSERT_EQUAL(documents.size(), expected_documents.size());
+			for (size_t i = 0; i < documents.size(); ++i) {
+				ASSERT_EQUAL(documents[i].id, expected_documents[i].id);
+				ASSERT_EQUAL(documents[i].relevance, expected_documents[i].relevance);
+			}
+		}
+		for (const int id : expected_server) {
+			ASSERT(get<0>(search_server.MatchDocument(query, id)) == get<0>(expected_server.MatchDocument(query, id)));
+			ASSERT(get<0>(search_server.MatchDocument(execution::par, query, id)) == get<0>(expected_server.MatchDocument(query, id)));
+		}
+	}
+	for (const int id : expected_server) {
+		ASSERT(search_server.GetWordFrequencies(id) == expected_server.GetWordFrequencies(id));
+	}
+}
+
+//тексты документов читаются из выбранного хранилища, поиск от него не зависит
+void TestDocumentTextStore()
+{
+	SearchServer search_server("и в на"s);
+	vector<string> texts;
+	for (int id = 0; id < 40; ++id) {
+		texts.push_back("кот номер "s + to_string(id) + (id % 2 ? " пушистый"s : " ухоженный"s));
+		search_server.AddDocument(id, texts.back(), DocumentStatus::ACTUAL, { id });
+	}
+	ASSERT_EQUAL(search_server.GetDocumentText(7), texts[7]);
+
+	const string path = "search_server_test_texts.bin"s;
+	search_server.SetTextStorage(DocumentTextStore::Mode::FILE, path);
+	for (int id = 40; id < 50; ++id) {
+		texts.push_back("пёс номер "s + to_string(id));
+		search_server.AddDocument(id, texts.back(), DocumentStatus::ACTUAL, { id });
+	}
+	for (int id = 0; id < 50; id += 3) {
+		search_server.RemoveDocument(id);
+	}
+	for (const int id : search_server) {
+		ASSERT_EQUAL(search_server.GetDocumentText(id), texts[id]);
+	}
+	const auto documents = search_server.FindTopDocuments("пушистый пёс"s);
+
+	search_server.SetTextStorage(DocumentTextStore::Mode::MEMORY);
+	remove(path.c_str());
+	for (int id = 0; id < 50; id += 2) {
+		search_server.RemoveDocument(id);
+	}
+	for (const int id : search_server) {
+		ASSERT_EQUAL(search_server.GetDocumentText(id), texts[id]);
+	}
+
+	search_server.SetTextStorage(DocumentTextStore::Mode::NONE);
+	ASSERT(search_server.GetDocumentText(1).empty());
+	ASSERT_EQUAL(search_server.FindTopDocuments("пушистый пёс"s).size(), documents.size());
+	try {
+		search_server.GetDocumentText(0);
+		ASSERT_HINT(false, "removed document has no text"s);
+	}
+	catch (const invalid_argument&) {
+	}
+}
+
+void TestMemoryResource()
+{
+	vector<string> texts;
+	for (int id = 0; id < 300; ++id) {
+		texts.push_back("кот номер "s + to_string(id % 37) + (id % 3 ? " пушистый"s : " ухоженный хвост"s));
+	}
+	SearchServer expected("и в на"s);
+	for (int id = 0; id < 300; ++id) {
+		expected.AddDocument(id, texts[id], DocumentStatus::ACTUAL, { id });
+	}
+
+	// индекс не должен обращаться к ресурсу по умолчанию
+	pmr::monotonic_buffer_resource arena;
+	pmr::memory_resource* const default_resource = pmr::set_default_resource(pmr::null_memory_resource());
+	try {
+		SearchServer search_server("и в на"s, &arena);
+		for (int id = 0; id < 300; ++id) {
+			search_server.AddDocument(id, texts[id], DocumentStatus::ACTUAL, { id });
+		}
+		for (int id = 0; id < 300; id += 4) {
+			search_server.RemoveDocument(id);
+			expected.RemoveDocument(id);
+		}
+		const auto documents = search_server.FindTopDocuments("пушистый кот -хвост"s);
+		const auto expected_documents = expected.FindTopDocuments("пушистый кот -хвост"s);
+		ASSERT_EQUAL(documents.size(), expected_documents.size());
+		for (size_t i = 0; i < documents.size(); ++i) {
+			ASSERT_EQUAL(documents[i].id, expected_documents[i].id);
+		}
+		pmr::set_default_resource(default_resource);
+	}
+	catch (...) {
+		pmr::set_default_resource(default_resource);
+		throw;
+	}
+
+	pmr::synchronized_pool_resource pool;
+	SearchServer search_server("и в на"s, &pool);
+	vector<RawDocument> documents;
+	for (int id = 0; id < 300; ++id) {
+		documents.push_back({ id, texts[id], DocumentStatus::ACTUAL, { id } });
+	}
+	search_server.AddDocuments(execution::par, documents);
+	search_server.RemoveDocument(execution::par, 5);
+	ASSERT_EQUAL(search_server.GetDocumentCount(), 299);
+	ASSERT_EQUAL(get<0>(search_server.MatchDocument("хвост"s, 6)).size(), 1u);
+}
+
+//удалённые пометкой документы не находятся до уплотнения и после него, idf считается только по оставшимся
+void TestRemoveDocuments()
+{
+	const vector<string> texts = { "белый кот и модный ошейник"s, "пушистый кот пушистый хвост"s,
+		"ухоженный пёс выразительные глаза"s, "ухоженный скворец евгений"s, "белый пёс и чёрный хвост"s };
+	SearchServer search_server("и в на"s);
+	SearchServer expected_server("и в на"s);
+	vector<int> removed_ids;
+	for (int id = 0; id < 300; ++id) {
+		search_server.AddDocument(id, texts[id % texts.size()] + " "s + to_string(id % 7), DocumentStatus(id % 2), { id });
+		if (id % 4 == 0) {
+			removed_ids.push_back(id);
+		}
+		else {
+			expected_server.AddDocument(id, texts[id % texts.size()] + " "s + to_string(id % 7), DocumentStatus(id % 2), { id });
+		}
+	}
+	removed_ids.push_back(1000);
+	search_server.RemoveDocuments(execution::par, removed_ids);
+
+	const auto check = [&expected_server](const SearchServer& server) {
+		ASSERT_EQUAL(server.GetDocumentCount(), expected_server.GetDocumentCount());
+		for (const string& query : { "пушистый кот"s, "ухоженный пёс -хвост"s, "белый 3 4 -кот"s }) {
+			const auto documents = server.FindTopDocuments(execution::par, query, [](int document_id, DocumentStatus, int) {
+				return document_id % 3 != 0;
+			});
+			const auto expected_documents = expected_server.FindTopDocuments(query, [](int document_id, DocumentStatus, int) {
+				return document_id % 3 != 0;
+			});
+			ASSERT_EQUAL(documents.size(), expected_documents.size());
+			for (size_t i = 0; i < documents.size(); ++i) {
+				ASSERT_EQUAL(documents[i].id, expected_documents[i].id);
+				ASSERT_EQUAL(documents[i].relevance, expected_documents[i].relevance);
+			}
+			ASSERT_EQUAL(server.FindTopDocuments(query, DocumentStatus::IRRELEVANT, 100).size(),
+				expected_server.FindTopDocuments(query, DocumentStatus::IRRELEVANT, 100).size());
+		}
+	};
+	check(search_server);
+	const string path = "search_server_test_removed.bin"s;
+	search_server.Save(path);
+	check(SearchServer::Load(path));
+	remove(path.c_str());
+	search_server.Compact(execution::par);
+	check(search_server);
+	ASSERT(get<0>(search_server.MatchDocument("пушистый хвост"s, 1)) == get<0>(expected_server.MatchDocument("пушистый хвост"s, 1)));
+}
+
+//дубликатом считается документ с тем же набором слов, что у документа с меньшим id
+void TestRemoveDuplicates()
+{
+	for (const bool is_parallel : { false, true }) {
+		SearchServer search_server("and with"s);
+		search_server.AddDocument(1, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, { 7, 2, 7 });
+		search_server.AddDocument(2, "funny pet with curly hair"s, DocumentStatus::ACTUAL, { 1, 2 });
+		search_server.AddDocument(3, "funny pet with curly hair"s, DocumentStatus::ACTUAL, { 1, 2 });
+		search_server.AddDocument(4, "funny pet and curly hair"s, DocumentStatus::ACTUAL, { 1, 2 });
+		search_server.AddDocument(5, "funny funny pet and nasty nasty rat"s, DocumentStatus::ACTUAL, { 1, 2 });
+		search_server.AddDocument(6, "funny pet and not very nasty rat"s, DocumentStatus::ACTUAL, { 1, 2 });
+		search_server.AddDocument(7, "very nasty rat and not very funny pet"s, DocumentStatus::ACTUAL, { 1, 2 });
+		search_server.AddDocument(8, "pet with rat and rat and rat"s, DocumentStatus::ACTUAL, { 1, 2 });
+		search_server.AddDocument(9, "nasty rat with curly hair"s, DocumentStatus::ACTUAL, { 1, 2 });
+		// меньший id добавлен позже
+		search_server.AddDocument(0, "rat pet"s, DocumentStatus::BANNED, { 1, 2 });
+
+		const vector<int> removed_ids = is_parallel ? search_server.RemoveDuplicates(execution::par) : search_server.RemoveDuplicates();
+		ASSERT(removed_ids == vector<int>({ 3, 4, 5, 7, 8 }));
+		ASSERT(vector<int>(search_server.begin(), search_server.end()) == vector<int>({ 0, 1, 2, 6, 9 }));
+		ASSERT(search_server.RemoveDuplicates().empty());
+	}
+}
+
+//пакетная обработка даёт те же результаты, что и последовательные запросы, каждый результат приходит один раз
+void TestBatchQueryExecutor()
+{
+	const vector<string> words = { "белый"s, "кот"s, "пушистый"s, "хвост"s, "пёс"s, "ухоженный"s, "ошейник"s, "скворец"s };
+	SearchServer search_server("и в на"s);
+	mt19937 generator(7);
+	for (int id = 0; id < 2000; ++id) {
+		string text;
+		for (int i = 0; i < 8; ++i) {
+			text += words[generator() % words.size()] + " "s;
+		}
+		search_server.AddDocument(id, text, DocumentStatus(id % 3), { id % 10 });
+	}
+	vector<string> queries;
+	for (int i = 0; i < 200; ++i) {
+		queries.push_back(words[i % words.size()] + " "s + words[(i * 3 + 1) % words.size()] + (i % 4 ? " -"s + words[i % 5] : ""s));
+	}
+
+	BatchQueryExecutor executor(3);
+	for (int pass = 0; pass < 2; ++pass) {
+		vector<vector<Document>> results(queries.size());
+		vector<int> result_counts(queries.size());
+		mutex results_mutex;
+		executor.Process(search_server, queries, [&](size_t query_index, vector<Document> documents) {
+			lock_guard guard(results_mutex);
+			results[query_index] = move(documents);
+			++result_counts[query_index];
+		});
+		for (size_t i = 0; i < queries.size(); ++i) {
+			ASSERT_EQUAL(result_counts[i], 1);
+			const auto expected_documents = search_server.FindTopDocuments(queries[i]);
+			ASSERT_EQUAL(results[i].size(), expected_documents.size());
+			for (size_t j = 0; j < expected_documents.size(); ++j) {
+				ASSERT_EQUAL(results[i][j].id, expected_documents[j].id);
+				ASSERT_EQUAL(results[i][j].relevance, expected_documents[j].relevance);
+			}
+		}
+	}
+	ASSERT(ProcessQueries(search_server, queries)[5].size() == search_server.FindTopDocuments(queries[5]).size());
+
+	//пакеты из разных потоков выполняются одновременно: первый ждёт результата второго внутри своего запроса
+	{
+		BatchQueryExecutor shared_executor(2);
+		mutex second_mutex;
+		condition_variable second_cv;
+		bool is_first_started = false;
+		bool is_second_done = false;
+		bool is_first_waited = false;
+		thread first([&] {
+			shared_executor.Process(search_server, { queries[0] }, [&](size_t, vector<Document>) {
+				unique_lock lock(second_mutex);
+				is_first_started = true;
+				second_cv.notify_all();
+				is_first_waited = second_cv.wait_for(lock, 10s, [&] { return is_second_done; });
+			});
+		});
+		{
+			unique_lock lock(second_mutex);
+			second_cv.wait(lock, [&] { return is_first_started; });
+		}
+		shared_executor.Process(search_server, queries, [&](size_t, vector<Document>) {
+			lock_guard guard(second_mutex);
+			is_second_done = true;
+			second_cv.notify_all();
+		});
+		first.join();
+		ASSERT(is_first_waited);
+	}
+
+	queries[100] = "кот --хвост"s;
+	try {
+		executor.Process(search_server, queries, [](size_t, vector<Document>) {});
+		ASSERT_HINT(false, "invalid query must throw"s);
+	}
+	catch (const invalid_argument&) {
+	}
+}
+
+//плоские результаты пакета совпадают с результатами ProcessQueries, склеенными по порядку
+void TestProcessQueriesJoined()
+{
+	SearchServer search_server("and with"s);
+	int id = 0;
+	for (const string& text : { "funny pet and nasty rat"s, "funny pet with curly hair"s, "funny pet and not very nasty rat"s,
+		"pet with rat and rat and rat"s, "nasty rat with curly hair"s, "curly dog"s, "curly cat"s, "curly hair"s }) {
+		search_server.AddDocument(++id, text, DocumentStatus::ACTUAL, { 1, 2 });
+	}
+	const vector<string> queries = { "nasty rat -not"s, "unknown words"s, "curly and funny"s, "not"s, "dog"s, "unknown"s };
+	const auto results = ProcessQueries(search_server, queries);
+	const JoinedDocuments documents = ProcessQueriesJoined(search_server, queries);
+
+	vector<Document> expected_documents;
+	for (size_t i = 0; i < queries.size(); ++i) {
+		ASSERT(vector<Document>(documents.GetQueryDocuments(i).begin(), documents.GetQueryDocuments(i).end()) == results[i]);
+		expected_documents.insert(expected_documents.end(), results[i].begin(), results[i].end());
+	}
+	ASSERT_EQUAL(documents.GetQueryCount(), queries.size());
+	ASSERT_EQUAL(documents.size(), expected_documents.size());
+	ASSERT(vector<Document>(documents.begin(), documents.end()) == expected_documents);
+	const JoinedDocuments no_documents = ProcessQueriesJoined(search_server, { "unknown"s, "words"s });
+	ASSERT(no_documents.empty() && no_documents.begin() == no_documents.end());
+
+	//запись в буфер вызывающего совпадает с вектором результата, в том числе из кеша
+	SearchServer::QueryScratch scratch;
+	Document output[MAX_RESULT_DOCUMENT_COUNT];
+	for (int pass = 0; pass < 2; ++pass) {
+		for (const string& query : queries) {
+			const size_t count = search_server.FindTopDocuments(execution::seq, scratch, query, output);
+			ASSERT(vector<Document>(output, output + count) == search_server.FindTopDocuments(query));
+			const size_t top_count = search_server.FindTopDocuments(execution::par, scratch, query, output, DocumentStatus::ACTUAL, 2);
+			ASSERT(vector<Document>(output, output + top_count) == search_server.FindTopDocuments(query, DocumentStatus::ACTUAL, 2));
+		}
+		search_server.EnableResultCache(16);
+	}
+}
+
+//асинхронные запросы дают те же результаты; просроченные запросы и переполнение очереди сообщаются исключениями
+void TestAsyncSearchServer()
+{
+	SearchServer search_server("и в на"s);
+	for (int id = 0; id < 500; ++id) {
+		search_server.AddDocument(id, (id % 2 ? "пушистый кот "s : "ухоженный пёс "s) + to_string(id % 13), DocumentStatus(id % 2), { id });
+	}
+	SearchServer::QueryScratch scratch;
+	scratch.SetDeadline(chrono::steady_clock::now() - 1s);
+	for (const string& query : { "пушистый"s, "пушистый пёс"s }) {
+		try {
+			search_server.FindTopDocuments(execution::par, scratch, query, DocumentStatus::IRRELEVANT);
+			ASSERT_HINT(false, "expired query must throw"s);
+		}
+		catch (const QueryDeadlineExceeded&) {
+		}
+	}
+	scratch.ResetDeadline();
+	ASSERT(search_server.FindTopDocuments(execution::seq, scratch, "пушистый пёс"s) == search_server.FindTopDocuments("пушистый пёс"s));
+
+	AsyncSearchServer async_server(search_server, 2, 4);
+	auto expired = async_server.SubmitQuery("пушистый кот"s, DocumentStatus::ACTUAL, 0s);
+	vector<future<vector<Document>>> results;
+	int rejected_count = 0;
+	for (int i = 0; i < 100; ++i) {
+		try {
+			results.push_back(async_server.SubmitQuery("кот "s + to_string(i % 13), DocumentStatus::IRRELEVANT));
+		}
+		catch (const QueryRejected&) {
+			++rejected_count;
+		}
+	}
+	for (size_t i = 0; i < results.size(); ++i) {
+		ASSERT(!results[i].get().empty());
+	}
+	try {
+		expired.get();
+		ASSERT_HINT(false, "query with zero timeout must expire"s);
+	}
+	catch (const QueryDeadlineExceeded&) {
+	}
+	ASSERT(async_server.SubmitQuery("пёс 3"s).get() == search_server.FindTopDocuments("пёс 3"s));
+	const AsyncSearchServer::Stats stats = async_server.GetStats();
+	ASSERT_EQUAL(stats.rejected, static_cast<uint64_t>(rejected_count));
+	ASSERT_EQUAL(stats.accepted, 102u - rejected_count);
+	ASSERT_EQUAL(stats.expired, 1u);
+	ASSERT(!async_server.IsOverloaded());
+}
+
+//статистика запросов считается по реальному времени и не теряет записи из нескольких потоков
+void TestRequestQueue()
+{
+	SearchServer search_server("и в на"s);
+	search_server.AddDocument(1, "пушистый кот пушистый хвост"s, DocumentStatus::ACTUAL, { 7, 2, 7 });
+	RequestQueue request_queue(search_server);
+	ASSERT_EQUAL(request_queue.GetNoResultRequests(), 0);
+	request_queue.AddFindRequest("пёс"s);
+	request_queue.AddFindRequest("кот"s, DocumentStatus::ACTUAL);
+	request_queue.AddFindRequest("хвост"s, [](int, DocumentStatus, int rating) { return rating > 10; });
+	ASSERT_EQUAL(request_queue.GetNoResultRequests(), 2);
+
+	vector<thread> threads;
+	for (int thread_index = 0; thread_index < 4; ++thread_index) {
+		threads.emplace_back([&request_queue, thread_index] {
+			for (int i = 0; i < 1000; ++i) {
+				request_queue.AddResult(thread_index % 2, (i % 50 == 0) ? 100ms : 10us);
+			}
+		});
+	}
+	for (thread& thread : threads) {
+		thread.join();
+	}
+	const RequestQueue::Stats stats = request_queue.GetStats();
+	ASSERT_EQUAL(stats.request_count, 4003u);
+	ASSERT_EQUAL(stats.no_result_count, 2002u);
+	ASSERT(stats.queries_per_second > 0.0);
+	// задержки округляются вверх до границы корзины гистограммы
+	ASSERT(stats.latency_p50 >= 10us && stats.latency_p50 <= 13us);
+	ASSERT(stats.latency_p99 >= 100ms && stats.latency_p99 <= 125ms);
+
+	// окно сдвигается по подставленным часам, а не по настоящему времени
+	static RequestQueue::Clock::time_point now;
+	now = RequestQueue::Clock::time_point();
+	RequestQueue short_queue(search_server, 60ms, [] { return now; });
+	short_queue.AddFindRequest("пёс"s);
+	short_queue.AddResult(0, 100ms);
+	ASSERT_EQUAL(short_queue.GetNoResultRequests(), 2);
+	ASSERT(short_queue.GetStats().latency_p99 >= 100ms);
+	now += 50ms;
+	ASSERT_EQUAL(short_queue.GetNoResultRequests(), 2);
+	now += 20ms;
+	ASSERT_EQUAL(short_queue.GetNoResultRequests(), 0);
+}
+
+//редкое слово ищется без накопителя, частое - с ним; scratch после запроса остаётся чистым
+void TestSparseAndDenseSearch()
+{
+	SearchServer search_server("и в на"s);
+	const int document_count = 2000;
+	for (int id = 0; id < document_count; ++id) {
+		search_server.AddDocument(id, "общий "s + (id % 100 == 0 ? "редкий "s : "частый "s) + "слово"s + to_string(id % 7),
+			DocumentStatus::ACTUAL, { id % 10 });
+	}
+	const double rare_relevance = log(document_count / 20.0) / 3;
+	for (const auto& document : search_server.FindTopDocuments("редкий"s)) {
+		ASSERT_EQUAL(document.id % 100, 0);
+		ASSERT(abs(document.relevance - rare_relevance) < EXP);
+	}
+	ASSERT_EQUAL(search_server.FindTopDocuments("редкий"s, [](int, DocumentStatus, int) { return true; }).size(), 5u);
+	ASSERT(search_server.FindTopDocuments("редкий -слово0"s).size() == 5u);
+	for (const auto& document : search_server.FindTopDocuments("редкий -слово0"s)) {
+		ASSERT(document.id % 7 != 0);
+	}
+
+	SearchServer::QueryScratch scratch;
+	const auto dense = search_server.FindTopDocuments("частый слово3"s);
+	for (int i = 0; i < 3; ++i) {
+		ASSERT(search_server.FindTopDocuments(execution::seq, scratch, "частый слово3"s) == dense);
+		ASSERT(search_server.FindTopDocuments(execution::par, scratch, "частый слово3"s) == dense);
+		ASSERT(search_server.FindTopDocuments(execution::seq, scratch, "редкий"s) == search_server.FindTopDocuments("редкий"s));
+	}
+}
+
 // Функция TestSearchServer является точкой входа для запуска тестов
 void TestSearchServer() {
 	RUN_TEST(TestMachDocument);
@@ -331,6 +1287,29 @@ void TestSearchServer() {
 	RUN_TEST(TestSearchAllStatus);
 	RUN_TEST(TestResultsSortRelevance);
 	RUN_TEST(TestResultsSortRelevanceEps);
+	RUN_TEST(TestRemoveDocument);
+	RUN_TEST(TestFindTopDocumentsMaxCount);
+	RUN_TEST(TestConcurrentMap);
+	RUN_TEST(TestSnapshotSearchServer);
+	RUN_TEST(TestSnapshotHeldAcrossPublish);
+	RUN_TEST(TestAddDocuments);
+	RUN_TEST(TestSaveLoad);
+	RUN_TEST(TestResultCache);
+	RUN_TEST(TestSplitIntoWords);
+	RUN_TEST(TestTermIds);
+	RUN_TEST(TestPostingList);
+	RUN_TEST(TestTopDocumentsPruning);
+	RUN_TEST(TestStatusFilter);
+	RUN_TEST(TestCompactOrdinals);
+	RUN_TEST(TestDocumentTextStore);
+	RUN_TEST(TestMemoryResource);
+	RUN_TEST(TestRemoveDocuments);
+	RUN_TEST(TestRemoveDuplicates);
+	RUN_TEST(TestBatchQueryExecutor);
+	RUN_TEST(TestProcessQueriesJoined);
+	RUN_TEST(TestAsyncSearchServer);
+	RUN_TEST(TestRequestQueue);
+	RUN_TEST(TestSparseAndDenseSearch);
 	//RUN_TEST(TestResultsSortRelevanceEpsError);
 }
 // --------- Окончание модульных тестов поисковой системы -----------
\ No newline at end of file
@@ -26,5 +26,28 @@ void TestSearchAllStatus();
 void TestResultsSortRelevance();
 void TestResultsSortRelevanceEps();
 void TestResultsSortRelevanceEpsError();
+void TestRemoveDocument();
+void TestFindTopDocumentsMaxCount();
+void TestConcurrentMap();
+void TestSnapshotSearchServer();
+void TestSnapshotHeldAcrossPublish();
+void TestAddDocuments();
+void TestSaveLoad();
+void TestResultCache();
+void TestSplitIntoWords();
+void TestTermIds();
+void TestPostingList();
+void TestTopDocumentsPruning();
+void TestStatusFilter();
+void TestCompactOrdinals();
+void TestDocumentTextStore();
+void TestMemoryResource();
+void TestRemoveDocuments();
+void TestRemoveDuplicates();
+void TestBatchQueryExecutor();
+void TestProcessQueriesJoined();
+void TestAsyncSearchServer();
+void TestRequestQueue();
+void TestSparseAndDenseSearch();
 //главный тест
 void TestSearchServer();
@@ -0,0 +1,6 @@
+#include "test_example_functions.h"
+
+// модульные тесты: при ошибке ASSERT печатает её и завершает процесс с ненулевым кодом
+int main() {
+	TestSearchServer();
+}